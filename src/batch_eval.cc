@@ -0,0 +1,190 @@
+#include "batch_eval.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+namespace batch_eval {
+
+namespace {
+
+using Row = Board::Row;
+
+// bit j is set if column j - 1 is filled, the left wall counts as filled
+constexpr Row LeftNeighbours(Row r) { return Row(r << 1) | 1; }
+// bit j is set if column j + 1 is filled, the right wall counts as filled
+constexpr Row RightNeighbours(Row r) {
+  return (r >> 1) | (1 << (Board::width - 1));
+}
+// the row with both walls, so a transition at either wall shows up
+constexpr Row Walled(Row r) {
+  return Row(r << 1) | 1 | 1 << (Board::width + 1);
+}
+constexpr Row kWalledMask = (1 << (Board::width + 1)) - 1;
+
+}  // namespace
+
+Features ComputeFeaturesScalar(const Board& board) {
+  Features f;
+  Row seen = 0;
+  for (int i = Board::height - 1; i >= 0; --i) {
+    Row r = board.grid.row(i);
+    for (Row fresh = r & ~seen; fresh; fresh &= fresh - 1) {
+      f.heights[std::countr_zero(fresh)] = i + 1;
+    }
+    f.holes += std::popcount(Row(seen & ~r));
+    seen |= r;
+    if (seen) {
+      Row w = Walled(r);
+      f.row_transitions += std::popcount(Row((w ^ (w >> 1)) & kWalledMask));
+    }
+    Row open = ~seen & Board::kFullRow;
+    f.wells +=
+        std::popcount(Row(open & LeftNeighbours(r) & RightNeighbours(r)));
+  }
+  for (int j = 1; j < Board::width; ++j) {
+    f.bumpiness += std::abs(f.heights[j] - f.heights[j - 1]);
+  }
+  return f;
+}
+
+#if defined(__GNUC__) && !defined(BATCH_EVAL_SCALAR)
+
+namespace {
+
+// one 16-bit lane per board
+typedef uint16_t Lanes __attribute__((vector_size(2 * kLanes)));
+
+Lanes Popcount(Lanes x) {
+  x = x - ((x >> 1) & 0x5555);
+  x = (x & 0x3333) + ((x >> 2) & 0x3333);
+  x = (x + (x >> 4)) & 0x0f0f;
+  return (x + (x >> 8)) & 0x1f;
+}
+
+// all ones where `x` is non-zero
+Lanes NonZero(Lanes x) { return (Lanes)(x != 0); }
+
+Lanes AbsDiff(Lanes a, Lanes b) {
+  Lanes gt = (Lanes)(a > b);
+  return ((a - b) & gt) | ((b - a) & ~gt);
+}
+
+// bit-sliced counter: bit j of `planes[k]` is bit k of the count of column j
+struct ColumnCounter {
+  std::array<Lanes, 5> planes{};  // counts up to 31 >= Board::height
+
+  void Add(Lanes bits) {
+    for (auto& plane : planes) {
+      Lanes carry = plane & bits;
+      plane ^= bits;
+      bits = carry;
+    }
+  }
+  Lanes Column(int j) const {
+    Lanes count{};
+    for (int k = 0; k < 5; ++k) count |= ((planes[k] >> j) & 1) << k;
+    return count;
+  }
+};
+
+// row struct-of-arrays: `block[i][b]` is row `i` of board `b`
+using Block = std::array<std::array<uint16_t, kLanes>, Board::height>;
+
+// rows from `top` up are empty in all boards of the block
+void ComputeBlock(const Block& block, int top, Features* out, size_t n) {
+  Lanes seen{}, holes{}, transitions{}, wells{};
+  // a column's height is the number of rows at or below its top
+  ColumnCounter heights;
+  for (int i = top - 1; i >= 0; --i) {
+    Lanes r;
+    std::memcpy(&r, block[i].data(), sizeof(r));
+    holes += Popcount(seen & ~r);
+    seen |= r;
+    heights.Add(seen);
+    Lanes w = (r << 1) | (1 | 1 << (Board::width + 1));
+    transitions += Popcount((w ^ (w >> 1)) & kWalledMask) & NonZero(seen);
+    Lanes open = ~seen & Board::kFullRow;
+    Lanes left = (r << 1) | 1;
+    Lanes right = (r >> 1) | (1 << (Board::width - 1));
+    wells += Popcount(open & left & right);
+  }
+  std::array<Lanes, Board::width> height;
+  for (int j = 0; j < Board::width; ++j) height[j] = heights.Column(j);
+  Lanes bumpiness{};
+  for (int j = 1; j < Board::width; ++j) {
+    bumpiness += AbsDiff(height[j], height[j - 1]);
+  }
+  for (size_t b = 0; b < n; ++b) {
+    Features& f = out[b];
+    for (int j = 0; j < Board::width; ++j) f.heights[j] = height[j][b];
+    f.holes = holes[b];
+    f.bumpiness = bumpiness[b];
+    f.row_transitions = transitions[b];
+    f.wells = wells[b];
+  }
+}
+
+// features of `n` boards, board `b` given by `get(b)`
+template <typename Get>
+void ComputeAll(size_t n, Get get, Features* out) {
+  Block block;
+  for (size_t begin = 0; begin < n; begin += kLanes) {
+    const size_t m = std::min(kLanes, n - begin);
+    // missing boards of the last block are left empty
+    if (m < kLanes) block = {};
+    int top = 0;
+    for (size_t b = 0; b < m; ++b) {
+      const Board& board = get(begin + b);
+      for (int i = 0; i < Board::height; ++i) block[i][b] = board.grid.row(i);
+      for (int i = Board::height; i > top; --i) {
+        if (board.grid.row(i - 1)) {
+          top = i;
+          break;
+        }
+      }
+    }
+    ComputeBlock(block, top, out + begin, m);
+  }
+}
+
+}  // namespace
+
+#else
+
+namespace {
+
+template <typename Get>
+void ComputeAll(size_t n, Get get, Features* out) {
+  for (size_t i = 0; i < n; ++i) out[i] = ComputeFeaturesScalar(get(i));
+}
+
+}  // namespace
+
+#endif
+
+void ComputeFeatures(std::span<const Board> boards, std::span<Features> out) {
+  assert(out.size() >= boards.size());
+  ComputeAll(
+      boards.size(), [&](size_t i) -> const Board& { return boards[i]; },
+      out.data());
+}
+
+void Evaluate(std::span<const PlayerBoard> boards, std::span<double> out) {
+  assert(out.size() >= boards.size());
+  std::array<Features, kLanes> features;
+  for (size_t begin = 0; begin < boards.size(); begin += kLanes) {
+    const size_t n = std::min(kLanes, boards.size() - begin);
+    ComputeAll(
+        n,
+        [&](size_t i) -> const Board& { return boards[begin + i].board(); },
+        features.data());
+    for (size_t b = 0; b < n; ++b) {
+      out[begin + b] = boards[begin + b].Evaluate(features[b].holes,
+                                                  features[b].bumpiness);
+    }
+  }
+}
+
+}  // namespace batch_eval
@@ -0,0 +1,62 @@
+#ifndef SRC_BATCH_EVAL_HH_
+#define SRC_BATCH_EVAL_HH_
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "board.hh"
+#include "player_board.hh"
+
+/**
+ * Board features computed from scratch for many boards at once.
+ *
+ * Boards are transposed into blocks of `kLanes` boards in row
+ * struct-of-arrays form (row `i` of every board of the block side by side)
+ * and scanned top down with bit-parallel kernels, one board per 16-bit lane.
+ * With GCC/Clang vector extensions a block row is one AVX2 register when
+ * built with `-mavx2`, else one SSE2 (or NEON) register; other compilers, or
+ * `-DBATCH_EVAL_SCALAR`, use the scalar kernel.
+ */
+namespace batch_eval {
+
+#if defined(__AVX2__)
+inline constexpr size_t kLanes = 16;
+#else
+inline constexpr size_t kLanes = 8;
+#endif
+
+struct Features {
+  // the same as `Board::Stats`
+  std::array<int8_t, Board::width> heights{};
+  int16_t holes = 0;
+  int16_t bumpiness = 0;
+  // filled/empty changes along every row up to the top of the stack, the
+  // walls count as filled
+  int16_t row_transitions = 0;
+  // empty cells with nothing above them whose left and right neighbours are
+  // filled (or walls)
+  int16_t wells = 0;
+  bool operator==(const Features&) const = default;
+};
+
+/**
+ * @brief Features of every board of `boards`, written to `out` which must be
+ * at least as long.
+ */
+void ComputeFeatures(std::span<const Board> boards, std::span<Features> out);
+
+/**
+ * @brief One board at a time, the reference for `ComputeFeatures`.
+ */
+Features ComputeFeaturesScalar(const Board& board);
+
+/**
+ * @brief `PlayerBoard::Evaluate()` of every board of `boards`, with the board
+ * features computed in batches instead of read from the cached stats.
+ */
+void Evaluate(std::span<const PlayerBoard> boards, std::span<double> out);
+
+}  // namespace batch_eval
+
+#endif  // SRC_BATCH_EVAL_HH_
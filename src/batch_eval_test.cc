@@ -0,0 +1,87 @@
+#include "batch_eval.hh"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "hash.h"
+
+namespace {
+
+// deterministic boards with a ragged stack and some holes
+std::vector<Board> RandomBoards(int n) {
+  std::vector<Board> boards(n);
+  uint64_t seed = 1;
+  for (auto& board : boards) {
+    seed = hash(seed);
+    int rows = seed % (Board::height - 4);
+    for (int i = 0; i < rows; ++i) {
+      seed = hash(seed);
+      board.grid.set_row(i, seed & (seed >> 16) & Board::kFullRow);
+    }
+  }
+  // empty rows below filled ones
+  boards[1].grid.set_row(Board::height - 1, 0b1000000001);
+  boards[2].grid.set_row(Board::height - 1, 0b0000010000);
+  return boards;
+}
+
+}  // namespace
+
+TEST(BatchEval, Features) {
+  // top down:
+  //   #.........
+  //   #.#.......
+  //   ###..#.###
+  Board board;
+  board.grid.set_row(2, 0b0000000001);
+  board.grid.set_row(1, 0b0000000101);
+  board.grid.set_row(0, 0b1110100111);
+  auto f = batch_eval::ComputeFeaturesScalar(board);
+  std::array<int8_t, Board::width> heights{3, 1, 2, 0, 0, 1, 0, 1, 1, 1};
+  EXPECT_EQ(f.heights, heights);
+  EXPECT_EQ(f.holes, 0);
+  EXPECT_EQ(f.bumpiness, 2 + 1 + 2 + 0 + 1 + 1 + 1 + 0 + 0);
+  EXPECT_EQ(f.row_transitions, 2 + 4 + 4);
+  // column 1 in the middle row, column 6 in the bottom row
+  EXPECT_EQ(f.wells, 2);
+}
+
+TEST(BatchEval, MatchesScalar) {
+  // not a multiple of the block size, so the last block is partial
+  auto boards = RandomBoards(3 * batch_eval::kLanes + 5);
+  std::vector<batch_eval::Features> features(boards.size());
+  batch_eval::ComputeFeatures(boards, features);
+  for (size_t i = 0; i < boards.size(); ++i) {
+    auto expected = batch_eval::ComputeFeaturesScalar(boards[i]);
+    ASSERT_EQ(features[i], expected) << "board " << i;
+    auto stats = boards[i].ComputeStats();
+    ASSERT_EQ(features[i].heights, stats.heights) << "board " << i;
+    ASSERT_EQ(features[i].holes, stats.holes) << "board " << i;
+    ASSERT_EQ(features[i].bumpiness, stats.bumpiness) << "board " << i;
+  }
+}
+
+TEST(BatchEval, MatchesEvaluate) {
+  PlayerBoard pb(7);
+  pb.LoadBoard(
+      "######....\n"
+      "#######...\n"
+      "########.#");
+  std::vector<PlayerBoard> boards;
+  for (int i = 0; i < 40; ++i) {
+    auto placements = pb.GeneratePlacements();
+    if (placements.empty()) break;
+    for (auto [x, y, d] : placements) {
+      boards.push_back(pb);
+      boards.back().SimulatePlacement(x, y, d);
+    }
+    auto [x, y, d] = placements[i % placements.size()];
+    pb.SimulatePlacement(x, y, d);
+  }
+  std::vector<double> evals(boards.size());
+  batch_eval::Evaluate(boards, evals);
+  for (size_t i = 0; i < boards.size(); ++i) {
+    ASSERT_EQ(evals[i], boards[i].Evaluate()) << "board " << i;
+  }
+}
@@ -0,0 +1,321 @@
+#include "beam_search.hh"
+
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <map>
+
+#include "instrument.hh"
+
+namespace {
+
+// best eval first, ties go to the larger first move id, then to the later
+// node; this is a strict total order, so the search is deterministic
+bool Better(const std::vector<double>& eval, const std::vector<uint16_t>& root,
+            uint32_t a, uint32_t b) {
+  if (eval[a] != eval[b]) return eval[a] > eval[b];
+  if (root[a] != root[b]) return root[a] > root[b];
+  return a > b;
+}
+
+}  // namespace
+
+BeamSearch::BeamSearch(Options options) : options_(options) {
+  assert(options_.max_depth >= 1 && options_.beam_width >= 1 &&
+         options_.branching_cap >= 1);
+  slice_ = options_.branching_cap * (options_.hold ? 2 : 1);
+  size_t capacity = options_.beam_width * slice_;
+  levels_.resize(options_.max_depth);
+  for (auto& level : levels_) {
+    level.parent.resize(capacity);
+    level.placement.resize(capacity);
+  }
+  curr_.resize(capacity);
+  next_.resize(capacity);
+  curr_eval_.resize(capacity);
+  next_eval_.resize(capacity);
+  curr_root_.resize(capacity);
+  next_root_.resize(capacity);
+  placements_.resize(capacity);
+  offsets_.reserve(options_.beam_width);
+  expanded_.resize(options_.beam_width);
+  if (options_.dedupe) {
+    // at most half full, so probe sequences stay short
+    size_t slots = std::bit_ceil(2 * capacity);
+    dedupe_.reset(new DedupeSlot[slots]);
+    dedupe_mask_ = slots - 1;
+    for (size_t i = 0; i < slots; ++i) {
+      dedupe_[i].key.store(0, std::memory_order_relaxed);
+      dedupe_[i].idx.store(kNoNode, std::memory_order_relaxed);
+    }
+    next_slot_.resize(capacity);
+  }
+}
+
+BeamSearch::Result BeamSearch::Search(const PlayerBoard& root,
+                                      const std::atomic<bool>* stop) {
+  INSTRUMENT_SCOPE(kSearch);
+  stop_ = stop;
+  deadline_ = Clock::now() + std::chrono::milliseconds(options_.time_budget_ms);
+  auto placements = root.GeneratePlacements(options_.hold);
+  assert(!placements.empty() && "should have at least ONE placement");
+  if (placements.size() > curr_.size()) {  // first level is not capped
+    for (auto& level : levels_) {
+      level.parent.resize(placements.size());
+      level.placement.resize(placements.size());
+    }
+    curr_.resize(placements.size());
+    curr_eval_.resize(placements.size());
+    curr_root_.resize(placements.size());
+  }
+
+  Stats stats;
+  stats.reused = options_.reuse ? Reroot(root, placements) : 0;
+  stats.depth = std::max(stats.reused, 1);
+  if (stats.reused == 0) Root(root, placements);
+  for (int level = stats.depth + 1; level <= options_.max_depth; ++level) {
+    if (!Expand(level, SelectBeam())) {
+      stats.stopped = true;  // the last full level stands
+      break;
+    }
+    if (LevelAt(level - 1).size == 0) break;  // every line topped out
+    Collect(LevelAt(level - 1).size);
+    stats.nodes += LevelAt(level - 1).size;
+    stats.duplicates += LevelAt(level - 1).size - alive_.size();
+    stats.depth = level;
+    std::swap(curr_, next_);
+    std::swap(curr_eval_, next_eval_);
+    std::swap(curr_root_, next_root_);
+  }
+
+  // ties go to the first node, in the order children were generated
+  uint32_t best = *std::max_element(
+      alive_.begin(), alive_.end(),
+      [&](uint32_t a, uint32_t b) { return curr_eval_[a] < curr_eval_[b]; });
+  Result result;
+  result.pv = PrincipalVariation(stats.depth, best);
+  result.placement = result.pv.front();
+  result.eval = curr_eval_[best];
+  result.stats = stats;
+  assert(result.placement == placements[curr_root_[best]]);
+  if (options_.reuse) {
+    reuse_root_ = root;
+    auto [x, y, d] = result.placement;
+    reuse_root_.SimulatePlacement(x, y, d);
+    reuse_id_ = curr_root_[best];
+    reuse_depth_ = stats.depth;
+  }
+  return result;
+}
+
+void BeamSearch::Root(const PlayerBoard& root,
+                      const std::vector<std::array<int, 3>>& placements) {
+  Level& first = LevelAt(0);
+  first.size = placements.size();
+  parlay::parallel_for(0, placements.size(), [&](size_t id) {
+    auto [x, y, d] = placements[id];
+    curr_[id] = root;
+    curr_[id].SimulatePlacement(x, y, d);
+    curr_eval_[id] = curr_[id].Evaluate(options_.weights);
+    curr_root_[id] = id;
+    first.parent[id] = 0;
+    first.placement[id] = {int8_t(x), int8_t(y), int8_t(d)};
+  });
+  // placements are distinct, so the first level has no duplicates
+  alive_ = parlay::tabulate(placements.size(),
+                            [](size_t i) { return uint32_t(i); });
+}
+
+int BeamSearch::Reroot(const PlayerBoard& root,
+                       const std::vector<std::array<int, 3>>& placements) {
+  const int depth = reuse_depth_ - 1;
+  reuse_depth_ = 0;
+  if (depth < 1 || !(root == reuse_root_)) return 0;
+
+  // the deepest level below the chosen move, it holds the best node
+  auto kept = parlay::filter(
+      alive_, [&](uint32_t idx) { return curr_root_[idx] == reuse_id_; });
+  assert(!kept.empty());
+  base_ = (base_ + 1) % levels_.size();
+  // first moves from `root` are the placements of the new first level, which
+  // were generated from the same state
+  std::map<std::array<int, 3>, uint16_t> ids;
+  for (size_t i = 0; i < placements.size(); ++i) ids[placements[i]] = i;
+  parlay::parallel_for(0, kept.size(), [&](size_t i) {
+    uint32_t idx = kept[i];
+    for (int level = depth - 1; level > 0; --level) {
+      idx = LevelAt(level).parent[idx];
+    }
+    auto [x, y, d] = LevelAt(0).placement[idx];
+    curr_root_[kept[i]] = ids.at({x, y, d});
+  });
+  alive_ = std::move(kept);
+  return depth;
+}
+
+std::vector<uint32_t> BeamSearch::SelectBeam() const {
+  INSTRUMENT_SCOPE(kSelect);
+  const size_t size = alive_.size();
+  const size_t k = std::min(size, options_.beam_width);
+  auto better = [&](uint32_t a, uint32_t b) {
+    return Better(curr_eval_, curr_root_, a, b);
+  };
+
+  // every block keeps its own top k, the survivors are then narrowed down
+  // to the global top k; only those k get sorted
+  const size_t block = std::max(kSelectBlock, k);
+  const size_t blocks = (size + block - 1) / block;
+  std::vector<uint32_t> candidates(alive_.begin(), alive_.end());
+  std::vector<size_t> kept(blocks);
+  parlay::parallel_for(0, blocks, [&](size_t i) {
+    const size_t begin = i * block, end = std::min(size, begin + block);
+    auto first = candidates.begin() + begin, last = candidates.begin() + end;
+    kept[i] = std::min(k, end - begin);
+    std::nth_element(first, first + kept[i] - 1, last, better);
+  }, 1);
+  std::vector<uint32_t> beam;
+  beam.reserve(blocks * k);
+  for (size_t i = 0; i < blocks; ++i) {
+    auto first = candidates.begin() + i * block;
+    beam.insert(beam.end(), first, first + kept[i]);
+  }
+  std::nth_element(beam.begin(), beam.begin() + k - 1, beam.end(), better);
+  beam.resize(k);
+  parlay::sort_inplace(beam, better);
+  return beam;
+}
+
+bool BeamSearch::Expand(int level, const std::vector<uint32_t>& beam) {
+  INSTRUMENT_SCOPE(kExpand);
+  const size_t m = beam.size();
+  offsets_.resize(m);
+  // once any thread sees it is time to stop, the other parents are skipped
+  std::atomic<bool> stopped = false;
+  auto out_of_time = [&] {
+    if (stopped.load(std::memory_order_relaxed)) return true;
+    if (!ShouldStop()) return false;
+    stopped.store(true, std::memory_order_relaxed);
+    return true;
+  };
+  parlay::parallel_for(0, m, [&](size_t j) {
+    if (out_of_time()) {
+      offsets_[j] = 0;
+      return;
+    }
+    // only the first `branching_cap` placements are kept, straight into the
+    // parent's slice of the arena
+    std::span slice(placements_.data() + j * slice_, slice_);
+    if (!options_.hold) {
+      offsets_[j] = std::min<size_t>(
+          slice_, curr_[beam[j]].GeneratePlacements(slice));
+      return;
+    }
+    // the held in piece comes after all of the current one, so both are
+    // capped on their own or a small cap would never hold
+    thread_local std::array<std::array<int, 3>, PlayerBoard::kMaxPlacements>
+        all;
+    const size_t cap = options_.branching_cap;
+    const auto end = all.begin() + curr_[beam[j]].GeneratePlacements(all, true);
+    const auto held = std::find_if(all.begin(), end, [](const auto& p) {
+      return p[2] >= PlayerBoard::kHold;
+    });
+    auto out = std::copy_n(all.begin(),
+                           std::min<size_t>(held - all.begin(), cap),
+                           slice.begin());
+    out = std::copy_n(held, std::min<size_t>(end - held, cap), out);
+    offsets_[j] = out - slice.begin();
+  });
+  const size_t total = parlay::scan_inplace(offsets_);
+
+  Level& next = LevelAt(level - 1);
+  next.size = total;
+  parlay::parallel_for(0, m, [&](size_t j) {
+    expanded_[j] = !out_of_time();
+    if (!expanded_[j]) return;
+    const uint32_t parent = beam[j];
+    const size_t begin = offsets_[j];
+    const size_t end = j + 1 < m ? offsets_[j + 1] : total;
+    for (size_t idx = begin; idx < end; ++idx) {
+      auto [x, y, d] = placements_[j * slice_ + idx - begin];
+      next_[idx] = curr_[parent];
+      next_[idx].SimulatePlacement(x, y, d);
+      next_eval_[idx] = next_[idx].Evaluate(options_.weights);
+      next_root_[idx] = curr_root_[parent];
+      next.parent[idx] = parent;
+      next.placement[idx] = {int8_t(x), int8_t(y), int8_t(d)};
+      if (options_.dedupe) Merge(idx);
+    }
+  });
+  if (!stopped) return true;
+
+  // the level is dropped, only children that were merged are in the table
+  if (options_.dedupe) {
+    parlay::parallel_for(0, m, [&](size_t j) {
+      if (!expanded_[j]) return;
+      const size_t end = j + 1 < m ? offsets_[j + 1] : total;
+      for (size_t idx = offsets_[j]; idx < end; ++idx) {
+        DedupeSlot& slot = dedupe_[next_slot_[idx]];
+        slot.key.store(0, std::memory_order_relaxed);
+        slot.idx.store(kNoNode, std::memory_order_relaxed);
+      }
+    });
+  }
+  return false;
+}
+
+void BeamSearch::Collect(size_t total) {
+  INSTRUMENT_SCOPE(kCollect);
+  if (!options_.dedupe) {
+    alive_ = parlay::tabulate(total, [](size_t i) { return uint32_t(i); });
+    return;
+  }
+  // a child stays if it is the node its state was merged into
+  alive_ = parlay::filter(parlay::iota<uint32_t>(total), [&](uint32_t idx) {
+    return dedupe_[next_slot_[idx]].idx.load(std::memory_order_relaxed) ==
+           idx;
+  });
+  parlay::parallel_for(0, total, [&](size_t idx) {
+    DedupeSlot& slot = dedupe_[next_slot_[idx]];
+    slot.key.store(0, std::memory_order_relaxed);
+    slot.idx.store(kNoNode, std::memory_order_relaxed);
+  });
+}
+
+void BeamSearch::Merge(uint32_t idx) {
+  // 0 marks an empty slot, so key 0 shares its entry with key 1
+  const uint64_t key = std::max<uint64_t>(next_[idx].Key(), 1);
+  size_t i = key & dedupe_mask_;
+  for (uint64_t found = 0;
+       !dedupe_[i].key.compare_exchange_strong(found, key,
+                                               std::memory_order_relaxed) &&
+       found != key;
+       found = 0) {
+    i = (i + 1) & dedupe_mask_;
+  }
+  next_slot_[idx] = i;
+
+  // the slot ends up with the best node whatever order the threads come in;
+  // release/acquire makes the eval of the node in the slot visible
+  std::atomic<uint32_t>& best = dedupe_[i].idx;
+  uint32_t old = best.load(std::memory_order_acquire);
+  while ((old == kNoNode || Better(next_eval_, next_root_, idx, old)) &&
+         !best.compare_exchange_weak(old, idx, std::memory_order_acq_rel,
+                                     std::memory_order_acquire)) {
+  }
+}
+
+std::vector<std::array<int, 3>> BeamSearch::PrincipalVariation(
+    int level, size_t idx) const {
+  std::vector<std::array<int, 3>> pv(level);
+  for (int i = level - 1; i >= 0; --i) {
+    auto [x, y, d] = LevelAt(i).placement[idx];
+    pv[i] = {x, y, d};
+    idx = LevelAt(i).parent[idx];
+  }
+  return pv;
+}
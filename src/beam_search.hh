@@ -0,0 +1,170 @@
+#ifndef SRC_BEAM_SEARCH_HH_
+#define SRC_BEAM_SEARCH_HH_
+
+#include <parlay/sequence.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "player_board.hh"
+
+/**
+ * Level-synchronous beam search over piece placements for one player.
+ *
+ * Every level keeps its nodes in a struct-of-arrays arena that is allocated
+ * once up front. Children are written in parallel into slots given by a
+ * prefix sum over the number of children of each parent, and every node
+ * remembers its parent so the whole line of play can be recovered.
+ *
+ * Different orders of placements often reach the same state. With `dedupe`
+ * on, children are merged by `PlayerBoard::Key()` (board, queue index, hold,
+ * b2b and combo) while they are generated, and only the best of each state
+ * stays in the level. With `hold`, placing the current piece and then the
+ * held one reaches the same state as the other way around.
+ *
+ * With a `time_budget_ms` the search is anytime: the deadline is checked
+ * before each parent is expanded, and a level that is not done in time is
+ * dropped, so the move comes from the deepest complete level.
+ *
+ * With `reuse`, the nodes below the chosen move survive the search. If the
+ * next search starts from the state that move leads to, they become its
+ * levels and only the missing deepest level is expanded. Those levels were
+ * pruned together with the other first moves, so the result can differ from
+ * a fresh search.
+ */
+class BeamSearch {
+ public:
+  struct Options {
+    int max_depth = 10;          // pieces placed along each line
+    size_t beam_width = 1000;    // best nodes (K) expanded per level
+    size_t branching_cap = 100;  // children kept per expanded node and piece
+    bool dedupe = true;          // merge children that reach the same state
+    // when positive, a level still running after this many milliseconds is
+    // dropped and the deepest complete level decides the move
+    int time_budget_ms = 0;
+    // keep the subtree of the chosen move and continue from it if the next
+    // search starts from where that move leads
+    bool reuse = false;
+    EvalWeights weights;  // of every `Evaluate()`
+    // also branch on holding, see `PlayerBoard::GeneratePlacements()`
+    bool hold = false;
+  };
+
+  struct Stats {
+    size_t nodes = 0;       // children generated below the first level
+    size_t duplicates = 0;  // of those, dropped for a better equal state
+    int depth = 0;          // deepest level that had nodes
+    bool stopped = false;   // time ran out or `stop` was set before the end
+    int reused = 0;         // levels carried over from the previous search
+  };
+
+  struct Result {
+    std::array<int, 3> placement;  // <x,y,d> of the best first move
+    double eval;                   // eval of the best node at `stats.depth`
+    // best line of play, starting with `placement`
+    std::vector<std::array<int, 3>> pv;
+    Stats stats;
+  };
+
+  explicit BeamSearch(Options options);
+
+  /**
+   * @brief Searches from `root`, which must have at least one placement.
+   *
+   * @param stop if given, setting it from another thread stops the search
+   * like the time budget running out
+   */
+  Result Search(const PlayerBoard& root,
+                const std::atomic<bool>* stop = nullptr);
+
+  const Options& options() const { return options_; }
+  // the budget can change from move to move, unlike the arena sizes
+  void set_time_budget_ms(int ms) { options_.time_budget_ms = ms; }
+
+ private:
+  /**
+   * Nodes of one level, `parent` indexes into the previous level.
+   */
+  struct Level {
+    size_t size = 0;
+    std::vector<uint32_t> parent;
+    std::vector<std::array<int8_t, 3>> placement;
+  };
+
+  // nodes are ranked in blocks of at least this many before the merge
+  constexpr static size_t kSelectBlock = 4096;
+
+  Options options_;
+  // a ring, `LevelAt(i)` holds nodes after i + 1 pieces
+  std::vector<Level> levels_;
+  size_t base_ = 0;
+  Level& LevelAt(int i) { return levels_[(base_ + i) % levels_.size()]; }
+  const Level& LevelAt(int i) const {
+    return levels_[(base_ + i) % levels_.size()];
+  }
+  // nodes of the level being expanded and of the one being generated
+  std::vector<PlayerBoard> curr_, next_;
+  std::vector<double> curr_eval_, next_eval_;
+  std::vector<uint16_t> curr_root_, next_root_;  // index of the first move
+
+  // where the chosen move of the last search leads, which first move it
+  // was, and how many levels the last search had (0 if nothing to reuse)
+  PlayerBoard reuse_root_;
+  uint16_t reuse_id_ = 0;
+  int reuse_depth_ = 0;
+  // nodes of `curr_` that survived the dedupe, in index order
+  parlay::sequence<uint32_t> alive_;
+  // children kept per expanded parent, `branching_cap` of each piece
+  size_t slice_ = 0;
+  // per expanded parent: its first `branching_cap` placements of each piece,
+  // in a slice of `placements_`, and where its children start
+  std::vector<std::array<int, 3>> placements_;
+  std::vector<size_t> offsets_;
+  std::vector<uint8_t> expanded_;  // whether each parent got its children
+
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point deadline_;
+  const std::atomic<bool>* stop_ = nullptr;
+  bool ShouldStop() const {
+    if (stop_ && stop_->load(std::memory_order_relaxed)) return true;
+    return options_.time_budget_ms > 0 && Clock::now() >= deadline_;
+  }
+
+  // open addressing table from a state key to the best node with that key
+  struct DedupeSlot {
+    std::atomic<uint64_t> key;  // 0 for an empty slot
+    std::atomic<uint32_t> idx;  // kNoNode until a node claims the slot
+  };
+  constexpr static uint32_t kNoNode = ~uint32_t(0);
+  std::unique_ptr<DedupeSlot[]> dedupe_;
+  size_t dedupe_mask_ = 0;
+  std::vector<uint32_t> next_slot_;  // slot every child was merged into
+
+  // the first level, every placement from `root`
+  void Root(const PlayerBoard& root,
+            const std::vector<std::array<int, 3>>& placements);
+  // makes the subtree of the last chosen move the tree of `root` if that is
+  // where the move led, returns the number of levels kept (0 if none)
+  int Reroot(const PlayerBoard& root,
+             const std::vector<std::array<int, 3>>& placements);
+  // indices of the best `beam_width` nodes of `alive_`, best first, found by
+  // a parallel partial selection
+  std::vector<uint32_t> SelectBeam() const;
+  // generates and evaluates the children of `beam` into `next_`, false if it
+  // had to stop first and the level is incomplete
+  bool Expand(int level, const std::vector<uint32_t>& beam);
+  // sets `alive_` to the `total` children of the new level that survived the
+  // dedupe, and clears the dedupe table for the next level
+  void Collect(size_t total);
+  // merges child `idx` of `next_` into the dedupe table, safe to call
+  // concurrently for different children
+  void Merge(uint32_t idx);
+  std::vector<std::array<int, 3>> PrincipalVariation(int level,
+                                                     size_t idx) const;
+};
+
+#endif  // SRC_BEAM_SEARCH_HH_
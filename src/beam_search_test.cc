@@ -0,0 +1,263 @@
+#include "beam_search.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include "test_util.hh"
+
+namespace {
+
+using test_util::TestBoard;
+
+struct ReferenceResult {
+  std::array<int, 3> placement;
+  double eval;
+  size_t nodes = 0, duplicates = 0;
+};
+
+// Plain beam search that keeps whole boards in one vector per level, used to
+// check the arena version.
+ReferenceResult ReferenceSearch(const PlayerBoard& root,
+                                BeamSearch::Options options) {
+  struct Node {
+    double eval;
+    int first;   // index of the first move
+    size_t idx;  // index among all children of the level
+    PlayerBoard pb;
+    auto rank() const { return std::tie(eval, first, idx); }
+  };
+  auto placements = root.GeneratePlacements(options.hold);
+  std::vector<Node> curr, next;
+  for (size_t i = 0; i < placements.size(); ++i) {
+    auto [x, y, d] = placements[i];
+    PlayerBoard pb(root);
+    pb.SimulatePlacement(x, y, d);
+    curr.push_back({pb.Evaluate(), int(i), i, pb});
+  }
+  ReferenceResult result;
+  for (int level = 2; level <= options.max_depth; ++level) {
+    std::sort(curr.begin(), curr.end(),
+              [](auto& a, auto& b) { return a.rank() > b.rank(); });
+    curr.resize(std::min(curr.size(), options.beam_width));
+    next.clear();
+    for (auto& parent : curr) {
+      auto children = parent.pb.GeneratePlacements(options.hold);
+      // each piece keeps its own first `branching_cap` placements
+      auto held = std::find_if(children.begin(), children.end(), [](auto& p) {
+        return p[2] >= PlayerBoard::kHold;
+      });
+      held = children.erase(
+          children.begin() +
+              std::min<size_t>(held - children.begin(), options.branching_cap),
+          held);
+      children.erase(held + std::min<size_t>(children.end() - held,
+                                             options.branching_cap),
+                     children.end());
+      for (auto [x, y, d] : children) {
+        PlayerBoard pb(parent.pb);
+        pb.SimulatePlacement(x, y, d);
+        next.push_back({pb.Evaluate(), parent.first, next.size(), pb});
+      }
+    }
+    if (next.empty()) break;
+    result.nodes += next.size();
+    if (options.dedupe) {
+      std::map<uint64_t, size_t> best;
+      for (size_t i = 0; i < next.size(); ++i) {
+        auto [it, added] = best.insert({next[i].pb.Key(), i});
+        if (!added && next[i].rank() > next[it->second].rank()) it->second = i;
+      }
+      std::vector<Node> kept;
+      for (size_t i = 0; i < next.size(); ++i) {
+        if (best[next[i].pb.Key()] == i) kept.push_back(next[i]);
+      }
+      result.duplicates += next.size() - kept.size();
+      next = kept;
+    }
+    std::swap(curr, next);
+  }
+  auto best = std::max_element(curr.begin(), curr.end(), [](auto& a, auto& b) {
+    return a.eval < b.eval;
+  });
+  result.placement = placements[best->first];
+  result.eval = best->eval;
+  return result;
+}
+
+}  // namespace
+
+TEST(BeamSearch, MatchesReference) {
+  for (BeamSearch::Options options : {
+           BeamSearch::Options{
+               .max_depth = 4, .beam_width = 40, .branching_cap = 20},
+           BeamSearch::Options{.max_depth = 4,
+                               .beam_width = 40,
+                               .branching_cap = 20,
+                               .dedupe = false},
+           // beam narrower than the branching cap
+           BeamSearch::Options{
+               .max_depth = 4, .beam_width = 3, .branching_cap = 100},
+           // levels spanning several selection blocks
+           BeamSearch::Options{
+               .max_depth = 4, .beam_width = 300, .branching_cap = 40},
+           BeamSearch::Options{.max_depth = 4,
+                               .beam_width = 40,
+                               .branching_cap = 60,
+                               .hold = true},
+           // a cap smaller than either piece's placements
+           BeamSearch::Options{.max_depth = 4,
+                               .beam_width = 40,
+                               .branching_cap = 3,
+                               .hold = true},
+       }) {
+    BeamSearch search(options);
+    PlayerBoard pb = TestBoard();
+    for (int i = 0; i < 6; ++i) {
+      auto expected = ReferenceSearch(pb, options);
+      auto result = search.Search(pb);
+      ASSERT_EQ(result.placement, expected.placement) << "move " << i;
+      ASSERT_EQ(result.eval, expected.eval) << "move " << i;
+      ASSERT_EQ(result.stats.nodes, expected.nodes) << "move " << i;
+      ASSERT_EQ(result.stats.duplicates, expected.duplicates) << "move " << i;
+      if (!options.dedupe) {
+        ASSERT_EQ(result.stats.duplicates, 0);
+      }
+      auto [x, y, d] = result.placement;
+      pb.SimulatePlacement(x, y, d);
+    }
+  }
+}
+
+TEST(BeamSearch, Dedupe) {
+  BeamSearch::Options options{
+      .max_depth = 6, .beam_width = 200, .branching_cap = 40};
+  BeamSearch search(options);
+  auto result = search.Search(TestBoard());
+  EXPECT_GT(result.stats.duplicates, 0) << "some lines reach the same state";
+  auto expected = ReferenceSearch(TestBoard(), options);
+  EXPECT_EQ(result.stats.duplicates, expected.duplicates);
+  EXPECT_EQ(result.placement, expected.placement);
+  EXPECT_EQ(result.eval, expected.eval);
+}
+
+TEST(BeamSearch, Hold) {
+  PlayerBoard pb;
+  pb.LoadBoard(
+      "#########.\n"
+      "#########.\n"
+      "#########.\n"
+      "#########.");
+  pb.SetQueue({&pieces::O, &pieces::I, &pieces::T});
+  auto result = BeamSearch({.max_depth = 1, .hold = true}).Search(pb);
+  auto [x, y, d] = result.placement;
+  EXPECT_GE(d, PlayerBoard::kHold) << "the I is one hold away";
+  pb.SimulatePlacement(x, y, d);
+  EXPECT_EQ(pb.attack(), 4);
+  EXPECT_EQ(pb.hold_piece(), &pieces::O);
+}
+
+TEST(BeamSearch, HoldUnderBranchingCap) {
+  // the held in piece is capped on its own, so a small cap still holds
+  BeamSearch::Options options{.max_depth = 2,
+                              .beam_width = 1000,
+                              .branching_cap = 3,
+                              .dedupe = false,
+                              .hold = true};
+  PlayerBoard pb = TestBoard();
+  pb.SetQueue({&pieces::T, &pieces::I, &pieces::O});
+  size_t expected = 0;
+  for (auto [x, y, d] : pb.GeneratePlacements(true)) {
+    PlayerBoard child(pb);
+    child.SimulatePlacement(x, y, d);
+    auto children = child.GeneratePlacements(true);
+    size_t held = std::count_if(children.begin(), children.end(), [](auto& p) {
+      return p[2] >= PlayerBoard::kHold;
+    });
+    ASSERT_GT(held, 0);
+    expected += std::min<size_t>(children.size() - held, 3) +
+                std::min<size_t>(held, 3);
+  }
+  auto result = BeamSearch(options).Search(pb);
+  EXPECT_EQ(result.stats.nodes, expected);
+}
+
+TEST(BeamSearch, PrincipalVariation) {
+  BeamSearch search({.max_depth = 5, .beam_width = 50, .branching_cap = 20});
+  PlayerBoard pb = TestBoard();
+  auto result = search.Search(pb);
+  ASSERT_EQ(result.pv.size(), result.stats.depth);
+  EXPECT_EQ(result.pv.front(), result.placement);
+  // replaying the line of play reaches the node the eval came from
+  for (auto [x, y, d] : result.pv) pb.SimulatePlacement(x, y, d);
+  EXPECT_EQ(pb.Evaluate(), result.eval);
+}
+
+TEST(BeamSearch, TimeBudget) {
+  BeamSearch::Options options{
+      .max_depth = 10, .beam_width = 1000, .branching_cap = 100};
+  PlayerBoard pb = TestBoard();
+  auto full = BeamSearch(options).Search(pb);
+  EXPECT_FALSE(full.stats.stopped);
+
+  options.time_budget_ms = 1;
+  BeamSearch search(options);
+  for (int i = 0; i < 3; ++i) {
+    auto result = search.Search(pb);
+    EXPECT_TRUE(result.stats.stopped);
+    EXPECT_LT(result.stats.depth, options.max_depth);
+    // the line of play of the last complete level
+    ASSERT_EQ(result.pv.size(), result.stats.depth);
+    EXPECT_EQ(result.pv.front(), result.placement);
+    PlayerBoard replay(pb);
+    for (auto [x, y, d] : result.pv) replay.SimulatePlacement(x, y, d);
+    EXPECT_EQ(replay.Evaluate(), result.eval);
+  }
+
+  // a budget that does not run out changes nothing, also after levels were
+  // dropped
+  search.set_time_budget_ms(60 * 1000);
+  auto relaxed = search.Search(pb);
+  EXPECT_FALSE(relaxed.stats.stopped);
+  EXPECT_EQ(relaxed.placement, full.placement);
+  EXPECT_EQ(relaxed.eval, full.eval);
+  EXPECT_EQ(relaxed.stats.nodes, full.stats.nodes);
+}
+
+TEST(BeamSearch, Reuse) {
+  BeamSearch::Options options{
+      .max_depth = 6, .beam_width = 200, .branching_cap = 40, .reuse = true};
+  BeamSearch search(options), fresh({.max_depth = 6,
+                                     .beam_width = 200,
+                                     .branching_cap = 40});
+  PlayerBoard pb = TestBoard();
+  int depth = 0;
+  for (int i = 0; i < 6; ++i) {
+    auto result = search.Search(pb);
+    // everything but the last level comes from the previous move
+    EXPECT_EQ(result.stats.reused, std::max(depth - 1, 0)) << "move " << i;
+    ASSERT_EQ(result.pv.size(), result.stats.depth);
+    EXPECT_EQ(result.pv.front(), result.placement);
+    PlayerBoard replay(pb);
+    for (auto [x, y, d] : result.pv) replay.SimulatePlacement(x, y, d);
+    EXPECT_EQ(replay.Evaluate(), result.eval) << "move " << i;
+    if (i > 0) {
+      EXPECT_LT(result.stats.nodes, fresh.Search(pb).stats.nodes)
+          << "only the last level is expanded";
+    }
+    depth = result.stats.depth;
+    auto [x, y, d] = result.placement;
+    pb.SimulatePlacement(x, y, d);
+  }
+
+  // any other root starts over, as a fresh search would
+  PlayerBoard other = TestBoard();
+  auto result = search.Search(other);
+  auto expected = fresh.Search(other);
+  EXPECT_EQ(result.stats.reused, 0);
+  EXPECT_EQ(result.placement, expected.placement);
+  EXPECT_EQ(result.eval, expected.eval);
+  EXPECT_EQ(result.stats.nodes, expected.stats.nodes);
+}
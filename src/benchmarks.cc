@@ -0,0 +1,224 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+#include "board.hh"
+#include "hash.h"
+#include "pieces.hh"
+#include "player_board.hh"
+
+namespace {
+
+enum Fill { kEmpty, kMid, kMessy };
+constexpr const char* kFillNames[] = {"empty", "mid", "messy"};
+
+// `LoadBoard` string of a deterministic board for `fill`:
+//   mid: 8 rows of garbage, one gap per row
+//   messy: 14 rows of random cells, about 5/8 filled and never a full row
+std::string FillString(Fill fill, uint64_t seed) {
+  std::string s;
+  const int rows = fill == kEmpty ? 0 : fill == kMid ? 8 : 14;
+  for (int i = 0; i < rows; ++i) {
+    seed = hash(seed);
+    Board::Row row;
+    if (fill == kMid) {
+      row = Board::kFullRow & ~(Board::Row(1) << (seed % Board::width));
+    } else {
+      row = (seed | (seed >> 16)) & Board::kFullRow;
+      if (row == Board::kFullRow) {
+        row &= ~(Board::Row(1) << (seed >> 32) % Board::width);
+      }
+    }
+    for (int j = 0; j < Board::width; ++j) s += row >> j & 1 ? '#' : '.';
+    s += '\n';
+  }
+  return s;
+}
+
+PlayerBoard Fixture(Fill fill, const Piece* piece = &pieces::T) {
+  PlayerBoard pb(/*seed=*/fill + 1);
+  pb.LoadBoard(FillString(fill, fill + 1));
+  pb.set_current_piece(piece);
+  return pb;
+}
+
+// every offset the piece can be put at without going off the board
+std::vector<std::array<int, 3>> OnBoard(const Piece& piece) {
+  std::vector<std::array<int, 3>> offsets;
+  for (int d = 0; d < 4; ++d) {
+    const auto& extent = piece.extent(d);
+    for (int x = -extent.left; x + extent.right < Board::width; ++x) {
+      for (int y = -extent.bottom; y + extent.top < Board::height; ++y) {
+        offsets.push_back({x, y, d});
+      }
+    }
+  }
+  return offsets;
+}
+
+void SetFillLabel(benchmark::State& state, const Piece& piece, Fill fill) {
+  state.SetLabel(std::string(piece.name()) + "/" + kFillNames[fill]);
+}
+
+void BM_Intersects(benchmark::State& state) {
+  const Piece& piece = *pieces::kAll7[state.range(0)];
+  const Fill fill = Fill(state.range(1));
+  const Board board = Fixture(fill).board();
+  const auto offsets = OnBoard(piece);
+  for (auto _ : state) {
+    int hits = 0;
+    for (auto [x, y, d] : offsets) hits += piece.Intersects(board, x, y, d);
+    benchmark::DoNotOptimize(hits);
+  }
+  state.SetItemsProcessed(state.iterations() * offsets.size());
+  SetFillLabel(state, piece, fill);
+}
+BENCHMARK(BM_Intersects)->ArgsProduct({{0, 1, 2, 3, 4, 5, 6}, {0, 2}});
+
+void BM_Place(benchmark::State& state) {
+  const Piece& piece = *pieces::kAll7[state.range(0)];
+  const Fill fill = Fill(state.range(1));
+  const Board board = Fixture(fill).board();
+  std::vector<std::array<int, 3>> offsets;
+  for (auto [x, y, d] : OnBoard(piece)) {
+    if (!piece.Intersects(board, x, y, d)) offsets.push_back({x, y, d});
+  }
+  for (auto _ : state) {
+    for (auto [x, y, d] : offsets) {
+      Board copy = board;
+      benchmark::DoNotOptimize(piece.Place(copy, x, y, d));
+      benchmark::DoNotOptimize(copy);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * offsets.size());
+  SetFillLabel(state, piece, fill);
+}
+BENCHMARK(BM_Place)->ArgsProduct({{0, 1, 2, 3, 4, 5, 6}, {0, 2}});
+
+// includes a copy of the board, see BM_Copy
+void BM_ClearLines(benchmark::State& state) {
+  const int lines = state.range(0);
+  std::string s = FillString(kMessy, 3);
+  for (int i = 0; i < lines; ++i) s += "##########\n";
+  PlayerBoard pb;
+  pb.LoadBoard(s);
+  for (auto _ : state) {
+    PlayerBoard copy(pb);
+    benchmark::DoNotOptimize(copy.ClearLines());
+    benchmark::DoNotOptimize(copy);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClearLines)->Arg(0)->Arg(1)->Arg(4);
+
+// nodes are the placements generated, i.e. the children of a search node;
+// the grid is the same every iteration, so all but the first call find the
+// placements in the per-thread cache, see BM_GeneratePlacementsDistinct
+void BM_GeneratePlacements(benchmark::State& state) {
+  const Piece& piece = *pieces::kAll7[state.range(0)];
+  const Fill fill = Fill(state.range(1));
+  const PlayerBoard pb = Fixture(fill, &piece);
+  std::array<std::array<int, 3>, PlayerBoard::kMaxPlacements> out;
+  int64_t nodes = 0;
+  for (auto _ : state) {
+    int n = pb.GeneratePlacements(out);
+    benchmark::DoNotOptimize(out);
+    nodes += n;
+  }
+  state.counters["nodes"] =
+      benchmark::Counter(nodes, benchmark::Counter::kIsRate);
+  state.counters["placements"] =
+      nodes / std::max<int64_t>(1, state.iterations());
+  SetFillLabel(state, piece, fill);
+}
+BENCHMARK(BM_GeneratePlacements)
+    ->ArgsProduct({{0, 1, 2, 3, 4, 5, 6}, {0, 1, 2}});
+
+// the allocating overload, for comparison
+void BM_GeneratePlacementsVector(benchmark::State& state) {
+  const PlayerBoard pb = Fixture(Fill(state.range(0)));
+  int64_t nodes = 0;
+  for (auto _ : state) {
+    auto placements = pb.GeneratePlacements();
+    nodes += placements.size();
+    benchmark::DoNotOptimize(placements);
+  }
+  state.counters["nodes"] =
+      benchmark::Counter(nodes, benchmark::Counter::kIsRate);
+  state.SetLabel(kFillNames[state.range(0)]);
+}
+BENCHMARK(BM_GeneratePlacementsVector)->DenseRange(0, 2);
+
+// generating from scratch, on more distinct grids than the placement cache
+// keeps, with and without the hold piece
+void BM_GeneratePlacementsDistinct(benchmark::State& state) {
+  const Fill fill = Fill(state.range(0));
+  const bool hold = state.range(1);
+  std::vector<PlayerBoard> boards(4096, Fixture(fill));
+  for (size_t i = 0; i < boards.size(); ++i) {
+    boards[i].LoadBoard(FillString(fill, i + 1));
+    boards[i].set_hold_piece(&pieces::I);
+  }
+  std::array<std::array<int, 3>, PlayerBoard::kMaxPlacements> out;
+  int64_t nodes = 0;
+  size_t i = 0;
+  for (auto _ : state) {
+    nodes += boards[i].GeneratePlacements(out, hold);
+    benchmark::DoNotOptimize(out);
+    i = (i + 1) % boards.size();
+  }
+  state.counters["nodes"] =
+      benchmark::Counter(nodes, benchmark::Counter::kIsRate);
+  state.SetLabel(std::string(kFillNames[fill]) + (hold ? "/hold" : ""));
+}
+BENCHMARK(BM_GeneratePlacementsDistinct)->ArgsProduct({{1, 2}, {0, 1}});
+
+void BM_Evaluate(benchmark::State& state) {
+  const PlayerBoard pb = Fixture(Fill(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pb.Evaluate());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(kFillNames[state.range(0)]);
+}
+BENCHMARK(BM_Evaluate)->DenseRange(0, 2);
+
+// one search node: copy the parent, drop the piece from its spawn position
+void BM_Harddrop(benchmark::State& state) {
+  const PlayerBoard pb = Fixture(Fill(state.range(0)));
+  for (auto _ : state) {
+    PlayerBoard child(pb);
+    child.Harddrop();
+    benchmark::DoNotOptimize(child);
+  }
+  state.counters["nodes"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+  state.SetLabel(kFillNames[state.range(0)]);
+}
+BENCHMARK(BM_Harddrop)->DenseRange(0, 2);
+
+void BM_QueuePop(benchmark::State& state) {
+  PlayerBoard pb(/*seed=*/1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pb.QueuePop());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_QueuePop);
+
+void BM_Copy(benchmark::State& state) {
+  const PlayerBoard pb = Fixture(kMessy);
+  for (auto _ : state) {
+    PlayerBoard copy(pb);
+    benchmark::DoNotOptimize(copy);
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(PlayerBoard));
+}
+BENCHMARK(BM_Copy);
+
+}  // namespace
+
+BENCHMARK_MAIN();
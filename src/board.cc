@@ -1,9 +1,85 @@
 #include "board.hh"
 
 #include <array>
+#include <bit>
+#include <cassert>
+#include <cstdlib>
+
+namespace {
+
+int Bumpiness(const std::array<int8_t, Board::width>& heights) {
+  int bumpiness = 0;
+  for (int j = 1; j < Board::width; ++j) {
+    bumpiness += std::abs(heights[j] - heights[j - 1]);
+  }
+  return bumpiness;
+}
+
+}  // namespace
 
 void Board::Clear() {
-  grid ^= grid;
+  grid.reset();
+}
+
+Board::Stats Board::ComputeStats() const {
+  Stats stats;
+  Row seen = 0;  // columns whose top has been found
+  int cells = 0, total_height = 0;
+  for (int i = height - 1; i >= 0; --i) {
+    Row r = grid.row(i);
+    for (Row fresh = r & ~seen; fresh; fresh &= fresh - 1) {
+      stats.heights[std::countr_zero(fresh)] = i + 1;
+      total_height += i + 1;
+    }
+    seen |= r;
+    cells += std::popcount(r);
+  }
+  stats.holes = total_height - cells;
+  stats.bumpiness = Bumpiness(stats.heights);
+  return stats;
+}
+
+void Board::UpdateStats(Stats& stats, int lo, int hi, int added) const {
+  Row seen = 0;
+  for (int i = hi - 1; i >= lo; --i) {
+    Row r = grid.row(i);
+    for (Row fresh = r & ~seen; fresh; fresh &= fresh - 1) {
+      auto& h = stats.heights[std::countr_zero(fresh)];
+      if (h < i + 1) {
+        stats.holes += i + 1 - h;
+        h = i + 1;
+      }
+    }
+    seen |= r;
+  }
+  stats.holes -= added;
+  stats.bumpiness = Bumpiness(stats.heights);
+}
+
+void Board::DropRow(int i) {
+  for (; i + 1 < height; ++i) grid.set_row(i, grid.row(i + 1));
+  grid.set_row(height - 1, 0);
+}
+
+bool Board::RaiseRows(int n, Row row) {
+  assert(0 <= n && n <= height);
+  Row lost = 0;
+  for (int i = height - n; i < height; ++i) lost |= grid.row(i);
+  for (int i = height - 1; i >= n; --i) grid.set_row(i, grid.row(i - n));
+  for (int i = 0; i < n; ++i) grid.set_row(i, row);
+  return lost == 0;
+}
+
+int Board::ClearFullRows() {
+  int j = 0;
+  for (int i = 0; i < height; ++i) {  // scan from bottom to top
+    Row r = grid.row(i);
+    if (r == kFullRow) continue;
+    grid.set_row(j++, r);  // move row i to row j
+  }
+  int lines = height - j;
+  for (; j < height; ++j) grid.set_row(j, 0);
+  return lines;
 }
 
 std::ostream& operator<<(std::ostream& out, const Board& rhs) {
@@ -1,19 +1,142 @@
 #ifndef SRC_BOARD_HH_
 #define SRC_BOARD_HH_
 
-#include <bitset>
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 
+#include "hash.h"
+
 class Board {
  public:
-  void Clear();
-  friend std::ostream& operator<<(std::ostream& out, const Board& rhs);
-
   const static int width = 10;
   const static int height = 25;
-  typedef std::bitset<width * height> Grid;
+
+  /**
+   * One row of the board, bit `j` is the cell in column `j`.
+   */
+  typedef uint16_t Row;
+  constexpr static Row kFullRow = (Row(1) << width) - 1;
+
+  /**
+   * Board contents stored as one `Row` per line, from the bottom up. Cell
+   * `i * width + j` is row `i`, column `j`, matching the old bitset layout so
+   * `grid[k]` keeps working.
+   */
+  class Grid {
+   public:
+    constexpr bool operator[](size_t k) const {
+      return (rows_[k / width] >> (k % width)) & 1;
+    }
+    constexpr size_t size() const { return width * height; }
+    constexpr Row row(int i) const { return rows_[i]; }
+    constexpr void set_row(int i, Row r) { rows_[i] = r; }
+    constexpr void set(size_t k) { rows_[k / width] |= Row(1) << (k % width); }
+    constexpr const auto& rows() const { return rows_; }
+    constexpr void reset() { rows_.fill(0); }
+
+    constexpr bool any() const {
+      Row acc = 0;
+      for (auto r : rows_) acc |= r;
+      return acc != 0;
+    }
+
+    constexpr Grid& operator|=(const Grid& rhs) {
+      for (int i = 0; i < height; ++i) rows_[i] |= rhs.rows_[i];
+      return *this;
+    }
+    constexpr Grid& operator&=(const Grid& rhs) {
+      for (int i = 0; i < height; ++i) rows_[i] &= rhs.rows_[i];
+      return *this;
+    }
+    constexpr Grid& operator^=(const Grid& rhs) {
+      for (int i = 0; i < height; ++i) rows_[i] ^= rhs.rows_[i];
+      return *this;
+    }
+    constexpr Grid operator|(const Grid& rhs) const { return Grid(*this) |= rhs; }
+    constexpr Grid operator&(const Grid& rhs) const { return Grid(*this) &= rhs; }
+    constexpr Grid operator^(const Grid& rhs) const { return Grid(*this) ^= rhs; }
+    constexpr bool operator==(const Grid& rhs) const = default;
+
+   private:
+    std::array<Row, height> rows_{};
+  };
+
+  /**
+   * Surface features of the board, used by evaluation heuristics.
+   */
+  struct Stats {
+    std::array<int8_t, width> heights{};  // 1 + highest filled row, 0 if empty
+    int16_t holes = 0;      // empty cells below the top of their column
+    int16_t bumpiness = 0;  // sum of |height difference| of adjacent columns
+    bool operator==(const Stats&) const = default;
+  };
+
+  void Clear();
+
+  /**
+   * @brief Computes `Stats` from scratch with a single top-down row scan.
+   */
+  Stats ComputeStats() const;
+
+  /**
+   * @brief Updates `stats` after `added` cells were placed in rows [`lo`,
+   * `hi`), assuming nothing else changed since `stats` was computed.
+   */
+  void UpdateStats(Stats& stats, int lo, int hi, int added) const;
+
+  bool IsRowFull(int i) const { return grid.row(i) == kFullRow; }
+
+  /**
+   * @brief ORs `mask` into row `i`, used when placing pieces.
+   */
+  void OrRow(int i, Row mask) { grid.set_row(i, grid.row(i) | mask); }
+
+  /**
+   * @brief Removes row `i`, everything above it falls down by one row.
+   */
+  void DropRow(int i);
+
+  /**
+   * @brief Pushes every row up by `n` and fills the bottom `n` rows with
+   * `row`, used to receive garbage.
+   *
+   * @return `false` if filled cells were pushed off the top
+   */
+  bool RaiseRows(int n, Row row);
+
+  /**
+   * @brief Removes all full rows in a single pass, compacting the rest down.
+   *
+   * @return the number of rows removed
+   */
+  int ClearFullRows();
+
+  friend std::ostream& operator<<(std::ostream& out, const Board& rhs);
+  bool operator==(const Board&) const = default;
 
   Grid grid;  // contents of the board
 };
 
-#endif  // SRC_BOARD_HH_
\ No newline at end of file
+/**
+ * Fast hasher for `Board::Grid`, packs four rows per 64-bit word and mixes
+ * each word with splitmix.
+ */
+template <>
+struct std::hash<Board::Grid> {
+  size_t operator()(const Board::Grid& grid) const noexcept {
+    const auto& rows = grid.rows();
+    uint64_t h = 0;
+    for (size_t i = 0; i < rows.size(); i += 4) {
+      uint64_t word = 0;
+      for (size_t k = 0; k < 4 && i + k < rows.size(); ++k) {
+        word |= uint64_t(rows[i + k]) << (16 * k);
+      }
+      h = ::hash(h ^ word);
+    }
+    return h;
+  }
+};
+
+#endif  // SRC_BOARD_HH_
@@ -0,0 +1,73 @@
+#include "board.hh"
+
+#include <gtest/gtest.h>
+
+TEST(Board, RowLayout) {
+  Board b;
+  b.OrRow(1, 0b101);
+  EXPECT_TRUE(b.grid[Board::width * 1 + 0]);
+  EXPECT_FALSE(b.grid[Board::width * 1 + 1]);
+  EXPECT_TRUE(b.grid[Board::width * 1 + 2]);
+  EXPECT_TRUE(b.grid.any());
+  b.Clear();
+  EXPECT_FALSE(b.grid.any());
+}
+
+TEST(Board, ClearFullRows) {
+  Board b;
+  b.OrRow(0, Board::kFullRow);
+  b.OrRow(1, 0b1);
+  b.OrRow(2, Board::kFullRow);
+  b.OrRow(3, 0b10);
+  EXPECT_TRUE(b.IsRowFull(0));
+  EXPECT_FALSE(b.IsRowFull(1));
+  EXPECT_EQ(b.ClearFullRows(), 2) << "two full rows";
+  EXPECT_EQ(b.grid.row(0), 0b1) << "row 1 falls to row 0";
+  EXPECT_EQ(b.grid.row(1), 0b10) << "row 3 falls to row 1";
+  EXPECT_EQ(b.grid.row(2), 0) << "top is refilled with empty rows";
+}
+
+TEST(Board, DropRow) {
+  Board b;
+  for (int i = 0; i < Board::height; ++i) b.OrRow(i, i);
+  b.DropRow(3);
+  EXPECT_EQ(b.grid.row(2), 2) << "rows below are untouched";
+  EXPECT_EQ(b.grid.row(3), 4) << "rows above fall down";
+  EXPECT_EQ(b.grid.row(Board::height - 1), 0) << "top row is empty";
+}
+
+TEST(Board, RaiseRows) {
+  Board b;
+  b.OrRow(0, 0b1);
+  b.OrRow(1, 0b10);
+  EXPECT_TRUE(b.RaiseRows(2, 0b1111111011));
+  EXPECT_EQ(b.grid.row(0), 0b1111111011) << "bottom rows are filled";
+  EXPECT_EQ(b.grid.row(1), 0b1111111011);
+  EXPECT_EQ(b.grid.row(2), 0b1) << "rows above move up";
+  EXPECT_EQ(b.grid.row(3), 0b10);
+  EXPECT_TRUE(b.RaiseRows(0, 0)) << "nothing to raise";
+  EXPECT_FALSE(b.RaiseRows(Board::height - 3, 0)) << "row 3 is pushed off";
+  EXPECT_EQ(b.grid.row(Board::height - 1), 0b1);
+}
+
+TEST(Board, ComputeStats) {
+  Board b;
+  b.OrRow(0, 0b0000000101);
+  b.OrRow(2, 0b0000000001);
+  b.OrRow(3, 0b1000000000);
+  auto stats = b.ComputeStats();
+  std::array<int8_t, Board::width> heights{3, 0, 1, 0, 0, 0, 0, 0, 0, 4};
+  EXPECT_EQ(stats.heights, heights);
+  EXPECT_EQ(stats.holes, 1 + 3) << "one under column 0, three under column 9";
+  EXPECT_EQ(stats.bumpiness, 3 + 1 + 1 + 4);
+}
+
+TEST(Board, UpdateStats) {
+  Board b;
+  b.OrRow(0, 0b0000000011);
+  auto stats = b.ComputeStats();
+  b.OrRow(3, 0b0000000110);
+  b.OrRow(4, 0b0000000100);
+  b.UpdateStats(stats, 3, 5, 3);
+  EXPECT_EQ(stats, b.ComputeStats()) << "incremental update matches rescan";
+}
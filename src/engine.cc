@@ -0,0 +1,91 @@
+#include "engine.hh"
+
+Engine::Engine(BeamSearch::Options options, bool ponder)
+    : search_(options), ponder_(ponder), worker_([this] { Run(); }) {}
+
+Engine::~Engine() {
+  {
+    std::lock_guard lock(mutex_);
+    quit_ = true;
+    cancel_ = true;
+  }
+  changed_.notify_all();
+  worker_.join();
+}
+
+void Engine::Start(const PlayerBoard& root) {
+  std::lock_guard lock(mutex_);
+  result_.reset();
+  // `cancel_` set means the running search is already being thrown away
+  if (running_ && !cancel_ && running_->root == root) {
+    if (!running_->wanted) ++stats_.hits;
+    running_->wanted = true;
+    return;
+  }
+  if (pondered_ && pondered_root_ == root) {
+    ++stats_.hits;
+    result_ = std::move(pondered_);
+    pondered_.reset();
+    Ponder(root, *result_);
+    changed_.notify_all();
+    return;
+  }
+  // a ponder is dropped wherever it is, finished, queued or running, and
+  // counts as a miss once
+  if (pondered_) ++stats_.misses;
+  pondered_.reset();
+  if (queued_ && !queued_->wanted) ++stats_.misses;
+  if (running_ && !cancel_) {
+    if (!running_->wanted) ++stats_.misses;
+    cancel_ = true;
+  }
+  queued_ = Job{root, /*wanted=*/true};
+  changed_.notify_all();
+}
+
+BeamSearch::Result Engine::Wait() {
+  std::unique_lock lock(mutex_);
+  changed_.wait(lock, [&] { return result_.has_value(); });
+  return *result_;
+}
+
+Engine::Stats Engine::stats() const {
+  std::lock_guard lock(mutex_);
+  return stats_;
+}
+
+void Engine::Ponder(const PlayerBoard& root,
+                    const BeamSearch::Result& result) {
+  if (!ponder_ || queued_) return;  // or a real search is already waiting
+  PlayerBoard next(root);
+  auto [x, y, d] = result.placement;
+  next.SimulatePlacement(x, y, d);
+  if (next.GeneratePlacements().empty()) return;  // topped out
+  queued_ = Job{next, /*wanted=*/false};
+}
+
+void Engine::Run() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    changed_.wait(lock, [&] { return quit_ || queued_.has_value(); });
+    if (quit_) return;
+    running_ = std::move(queued_);
+    queued_.reset();
+    cancel_ = false;
+    const PlayerBoard root = running_->root;
+    lock.unlock();
+    auto result = search_.Search(root, &cancel_);
+    lock.lock();
+    Job job = *running_;
+    running_.reset();
+    if (cancel_) continue;  // thrown away, `Start` queued another search
+    if (job.wanted) {
+      result_ = result;
+      Ponder(job.root, result);
+      changed_.notify_all();
+    } else {
+      pondered_ = result;
+      pondered_root_ = job.root;
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#ifndef SRC_ENGINE_HH_
+#define SRC_ENGINE_HH_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "beam_search.hh"
+#include "player_board.hh"
+
+/**
+ * Asynchronous front end of `BeamSearch` that ponders.
+ *
+ * Once the best move of a search is known, the engine keeps searching on
+ * the state that move leads to while the caller applies and animates it.
+ * If the next `Start` asks for that state, the speculative search is the
+ * answer (finished or not). Otherwise it is cancelled through the search's
+ * stop flag and the real state is searched instead.
+ *
+ * Every search runs on one background thread owned by the engine, so only
+ * that thread ever forks parlay work. With `reuse` on, pondering searches
+ * continue from the tree of the move before. With `ponder` off nothing runs
+ * between `Wait` and the next `Start`, e.g. to collect instrument counters
+ * per move.
+ */
+class Engine {
+ public:
+  struct Stats {
+    size_t hits = 0;    // `Start` found its state already being pondered
+    size_t misses = 0;  // a ponder was thrown away for another state
+  };
+
+  explicit Engine(BeamSearch::Options options, bool ponder = true);
+  ~Engine();
+  Engine(const Engine&) = delete;
+  Engine& operator=(const Engine&) = delete;
+
+  /**
+   * @brief Starts searching `root` in the background and returns right
+   * away, `Wait` gets the result.
+   */
+  void Start(const PlayerBoard& root);
+
+  /**
+   * @brief Blocks until the search of the last `Start` is done, then starts
+   * pondering the state its best move leads to.
+   */
+  BeamSearch::Result Wait();
+
+  /**
+   * @brief `Start(root)` followed by `Wait()`.
+   */
+  BeamSearch::Result Think(const PlayerBoard& root) {
+    Start(root);
+    return Wait();
+  }
+
+  Stats stats() const;
+
+ private:
+  struct Job {
+    PlayerBoard root;
+    bool wanted;  // someone waits for the result, otherwise a ponder
+  };
+
+  void Run();
+  // queues a ponder of the state `result`'s move leads to from `root`, if
+  // pondering is on
+  void Ponder(const PlayerBoard& root, const BeamSearch::Result& result);
+
+  BeamSearch search_;  // only used by `worker_`
+  const bool ponder_;
+  std::atomic<bool> cancel_ = false;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::optional<Job> queued_;
+  std::optional<Job> running_;
+  // a finished ponder nobody asked for yet, and the state it searched
+  std::optional<BeamSearch::Result> pondered_;
+  PlayerBoard pondered_root_;
+  std::optional<BeamSearch::Result> result_;  // for `Wait`
+  Stats stats_;
+  bool quit_ = false;
+
+  std::thread worker_;  // last, it starts in the constructor
+};
+
+#endif  // SRC_ENGINE_HH_
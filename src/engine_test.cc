@@ -0,0 +1,100 @@
+#include "engine.hh"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+
+#include "test_util.hh"
+
+namespace {
+
+using test_util::TestBoard;
+
+constexpr BeamSearch::Options kOptions{
+    .max_depth = 5, .beam_width = 100, .branching_cap = 30, .reuse = true};
+
+}  // namespace
+
+TEST(Engine, PonderHits) {
+  Engine engine(kOptions);
+  BeamSearch search(kOptions);
+  PlayerBoard pb = TestBoard();
+  for (int i = 0; i < 6; ++i) {
+    auto result = engine.Think(pb);
+    // pondering runs the same searches, only earlier
+    auto expected = search.Search(pb);
+    ASSERT_EQ(result.placement, expected.placement) << "move " << i;
+    ASSERT_EQ(result.eval, expected.eval) << "move " << i;
+    ASSERT_EQ(result.stats.reused, expected.stats.reused) << "move " << i;
+    auto [x, y, d] = result.placement;
+    pb.SimulatePlacement(x, y, d);
+  }
+  EXPECT_EQ(engine.stats().hits, 5);
+  EXPECT_EQ(engine.stats().misses, 0);
+}
+
+TEST(Engine, PonderMisses) {
+  Engine engine(kOptions);
+  PlayerBoard pb = TestBoard();
+  engine.Think(pb);
+  // not the predicted state: the ponder is dropped and this is searched
+  PlayerBoard other = TestBoard();
+  other.set_current_piece(&pieces::I);
+  auto result = engine.Think(other);
+  auto expected = BeamSearch(kOptions).Search(other);
+  EXPECT_EQ(result.placement, expected.placement);
+  EXPECT_EQ(result.eval, expected.eval);
+  EXPECT_EQ(result.stats.nodes, expected.stats.nodes);
+  EXPECT_EQ(engine.stats().hits, 0);
+  EXPECT_EQ(engine.stats().misses, 1);
+}
+
+TEST(Engine, NoPonder) {
+  Engine engine(kOptions, /*ponder=*/false);
+  BeamSearch search(kOptions);
+  PlayerBoard pb = TestBoard();
+  for (int i = 0; i < 3; ++i) {
+    auto result = engine.Think(pb);
+    auto expected = search.Search(pb);
+    ASSERT_EQ(result.placement, expected.placement) << "move " << i;
+    ASSERT_EQ(result.eval, expected.eval) << "move " << i;
+    auto [x, y, d] = result.placement;
+    pb.SimulatePlacement(x, y, d);
+  }
+  EXPECT_EQ(engine.stats().hits, 0) << "nothing was searched ahead";
+  EXPECT_EQ(engine.stats().misses, 0);
+}
+
+TEST(Engine, MissesCountOnce) {
+  Engine engine(kOptions);
+  engine.Think(TestBoard());
+  // the ponder is queued, running or finished by now, it is dropped once
+  // whichever it is, and so is nothing after it while it unwinds
+  PlayerBoard other = TestBoard();
+  other.set_current_piece(&pieces::I);
+  engine.Start(other);
+  other.set_current_piece(&pieces::O);
+  engine.Start(other);
+  engine.Start(other);
+  auto result = engine.Wait();
+  auto expected = BeamSearch(kOptions).Search(other);
+  EXPECT_EQ(result.placement, expected.placement);
+  EXPECT_EQ(result.eval, expected.eval);
+  EXPECT_EQ(engine.stats().hits, 0);
+  EXPECT_EQ(engine.stats().misses, 1);
+}
+
+TEST(Engine, StopsWhilePondering) {
+  // the destructor cancels the ponder of a deep search instead of waiting
+  BeamSearch::Options options{
+      .max_depth = 10, .beam_width = 1000, .branching_cap = 100};
+  auto engine = std::make_unique<Engine>(options);
+  auto start = std::chrono::steady_clock::now();
+  engine->Think(TestBoard());
+  auto search_time = std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  engine.reset();
+  auto stop_time = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(stop_time, search_time / 4) << "the ponder is not run out";
+}
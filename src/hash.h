@@ -8,6 +8,9 @@ worldwide. This software is distributed without any warranty.
 
 See <http://creativecommons.org/publicdomain/zero/1.0/>. */
 
+#ifndef SRC_HASH_H_
+#define SRC_HASH_H_
+
 #include <stdint.h>
 
 /* This is a fixed-increment version of Java 8's SplittableRandom generator
@@ -20,9 +23,11 @@ See <http://creativecommons.org/publicdomain/zero/1.0/>. */
    computations) or xorshift1024* (for massively parallel computations)
    generator. */
 
-uint64_t hash(uint64_t x) {
+constexpr uint64_t hash(uint64_t x) {
 	uint64_t z = (x += UINT64_C(0x9E3779B97F4A7C15));
 	z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
 	z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
 	return z ^ (z >> 31);
-}
\ No newline at end of file
+}
+
+#endif  // SRC_HASH_H_
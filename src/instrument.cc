@@ -0,0 +1,94 @@
+#include "instrument.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+
+namespace instrument {
+
+namespace {
+
+constexpr const char* kNames[kNumProbes] = {
+    "search",         "generate_placements", "collision_tests",
+    "line_clears",    "evaluations",         "select",
+    "expand",         "collect",             "attack_checks",
+    "attack_expands", "memo_hits",           "memo_misses",
+    "placements_shared",
+};
+
+constexpr bool kTimed[kNumProbes] = {
+    true, true, false, false, false, true,
+    true, true, false, false, false, false,
+    false,
+};
+
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<ThreadState>>& Registry() {
+  static auto* registry = new std::vector<std::unique_ptr<ThreadState>>();
+  return *registry;
+}
+
+}  // namespace
+
+std::atomic<bool> tracing = false;
+
+const char* Name(Probe probe) { return kNames[probe]; }
+
+ThreadState* Register() {
+  std::lock_guard lock(registry_mutex);
+  auto& registry = Registry();
+  registry.push_back(std::make_unique<ThreadState>());
+  registry.back()->tid = registry.size() - 1;
+  return registry.back().get();
+}
+
+Report Collect() {
+  std::lock_guard lock(registry_mutex);
+  Report report;
+  for (auto& state : Registry()) {
+    for (int p = 0; p < kNumProbes; ++p) {
+      report.count[p] += state->count[p].exchange(0, std::memory_order_relaxed);
+      report.nanos[p] += state->nanos[p].exchange(0, std::memory_order_relaxed);
+    }
+  }
+  return report;
+}
+
+std::string Report::ToJson() const {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(3) << "{";
+  for (int p = 0; p < kNumProbes; ++p) {
+    out << (p ? ", " : "") << "\"" << kNames[p] << "\": {\"count\": "
+        << count[p];
+    if (kTimed[p]) out << ", \"ms\": " << nanos[p] / 1e6;
+    out << "}";
+  }
+  out << "}";
+  return out.str();
+}
+
+void WriteChromeTrace(std::ostream& out) {
+  std::lock_guard lock(registry_mutex);
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\": [";
+  bool first = true;
+  for (auto& state : Registry()) {
+    std::vector<TraceEvent> trace;
+    {
+      std::lock_guard trace_lock(state->trace_mutex);
+      trace.swap(state->trace);
+    }
+    // complete events, timestamps in microseconds
+    for (const TraceEvent& e : trace) {
+      out << (first ? "\n" : ",\n") << "  {\"name\": \"" << kNames[e.probe]
+          << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << state->tid
+          << ", \"ts\": " << e.start_ns / 1e3
+          << ", \"dur\": " << e.duration_ns / 1e3 << "}";
+      first = false;
+    }
+  }
+  out << "\n]}\n";
+}
+
+}  // namespace instrument
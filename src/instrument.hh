@@ -0,0 +1,168 @@
+#ifndef SRC_INSTRUMENT_HH_
+#define SRC_INSTRUMENT_HH_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Per-thread counters and scoped timers for the search hot paths.
+ *
+ * The `INSTRUMENT_*` macros are what the hot paths use. They only do
+ * something when built with `-DINSTRUMENT` and expand to nothing otherwise.
+ * Every thread bumps its own counters without read-modify-write atomics.
+ * `Collect()` sums them over all threads and resets them, e.g. once per move.
+ * Scoped timers can also be kept as Chrome trace events.
+ *
+ * `Collect()` and `WriteChromeTrace()` are meant to be called between
+ * searches, while no thread is bumping counters.
+ */
+namespace instrument {
+
+enum Probe : int {
+  kSearch,              // whole searches, timed
+  kGeneratePlacements,  // placement generations, timed
+  kCollisionTests,      // piece positions tested against the board, one by
+                        // `IsValidPosition` or a row at once by placements
+  kLineClears,          // `PlayerBoard::ClearLines` calls
+  kEvaluations,         // `PlayerBoard::Evaluate` calls
+  kSelect,              // beam selections, timed
+  kExpand,              // generating and evaluating a beam level, timed
+  kCollect,             // gathering the deduped level, timed
+  kAttackChecks,        // `AttackPotential` nodes visited
+  kAttackExpands,       // of those, nodes that were not cut off
+  kMemoHits,            // `AttackPotential` memo probes that found their key
+  kMemoMisses,          // and those that did not
+  kPlacementsShared,    // piece placements reused from the per-thread cache
+  kNumProbes,
+};
+
+/**
+ * @brief Name used in the JSON and trace output, e.g. "generate_placements".
+ */
+const char* Name(Probe probe);
+
+inline constexpr bool kEnabled =
+#ifdef INSTRUMENT
+    true;
+#else
+    false;
+#endif
+
+/**
+ * Counters of all threads, summed.
+ */
+struct Report {
+  std::array<uint64_t, kNumProbes> count{};
+  std::array<uint64_t, kNumProbes> nanos{};  // only for timed probes
+
+  /**
+   * @brief e.g. `{"search": {"count": 1, "ms": 12.5}, "line_clears": ...}`,
+   * timed probes get their total time summed over threads.
+   */
+  std::string ToJson() const;
+};
+
+struct TraceEvent {
+  Probe probe;
+  int64_t start_ns, duration_ns;
+};
+
+/**
+ * Everything one thread recorded, only ever written by that thread.
+ */
+struct ThreadState {
+  int tid;
+  std::array<std::atomic<uint64_t>, kNumProbes> count{};
+  std::array<std::atomic<uint64_t>, kNumProbes> nanos{};
+  std::mutex trace_mutex;  // only contended while the trace is written out
+  std::vector<TraceEvent> trace;
+};
+
+// registers the calling thread, its state outlives the thread
+ThreadState* Register();
+
+inline thread_local ThreadState* local = nullptr;
+
+inline ThreadState& Local() {
+  if (!local) [[unlikely]] local = Register();
+  return *local;
+}
+
+// a plain add, as no other thread writes the counter
+inline void Bump(std::atomic<uint64_t>& counter, uint64_t n) {
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+inline void Add(Probe probe, uint64_t n = 1) { Bump(Local().count[probe], n); }
+
+inline int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+extern std::atomic<bool> tracing;
+
+/**
+ * @brief Starts or stops keeping timed scopes as trace events.
+ */
+inline void SetTracing(bool on) {
+  tracing.store(on, std::memory_order_relaxed);
+}
+
+/**
+ * Counts and times the enclosing scope.
+ */
+class Scope {
+ public:
+  explicit Scope(Probe probe) : probe_(probe), start_(NowNanos()) {}
+  ~Scope() {
+    const int64_t duration = NowNanos() - start_;
+    ThreadState& state = Local();
+    Bump(state.count[probe_], 1);
+    Bump(state.nanos[probe_], duration);
+    if (tracing.load(std::memory_order_relaxed)) {
+      std::lock_guard lock(state.trace_mutex);
+      state.trace.push_back({probe_, start_, duration});
+    }
+  }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  Probe probe_;
+  int64_t start_;
+};
+
+/**
+ * @brief Sums the counters of every thread and resets them.
+ */
+Report Collect();
+
+/**
+ * @brief Writes the trace events recorded so far in the Chrome trace event
+ * format (chrome://tracing, Perfetto) and drops them.
+ */
+void WriteChromeTrace(std::ostream& out);
+
+}  // namespace instrument
+
+#ifdef INSTRUMENT
+#define INSTRUMENT_COUNT(probe) ::instrument::Add(::instrument::probe)
+#define INSTRUMENT_ADD(probe, n) ::instrument::Add(::instrument::probe, n)
+#define INSTRUMENT_SCOPE(probe) \
+  ::instrument::Scope instrument_scope(::instrument::probe)
+#else
+#define INSTRUMENT_COUNT(probe) ((void)0)
+#define INSTRUMENT_ADD(probe, n) ((void)0)
+#define INSTRUMENT_SCOPE(probe) ((void)0)
+#endif
+
+#endif  // SRC_INSTRUMENT_HH_
@@ -0,0 +1,66 @@
+#include "instrument.hh"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using instrument::Collect;
+
+TEST(Instrument, CollectSumsThreads) {
+  Collect();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([] {
+      instrument::Add(instrument::kLineClears, 10);
+      instrument::Scope scope(instrument::kSelect);
+    });
+  }
+  for (auto& t : threads) t.join();
+  auto report = Collect();
+  EXPECT_EQ(report.count[instrument::kLineClears], 40);
+  EXPECT_EQ(report.count[instrument::kSelect], 4);
+  EXPECT_EQ(report.count[instrument::kEvaluations], 0);
+  // counts of threads that are gone are kept until collected
+  EXPECT_EQ(Collect().count[instrument::kLineClears], 0) << "reset";
+}
+
+TEST(Instrument, Json) {
+  Collect();
+  { instrument::Scope scope(instrument::kSearch); }
+  instrument::Add(instrument::kCollisionTests, 3);
+  auto json = Collect().ToJson();
+  EXPECT_NE(json.find("\"search\": {\"count\": 1, \"ms\": "), json.npos)
+      << json;
+  EXPECT_NE(json.find("\"collision_tests\": {\"count\": 3}"), json.npos)
+      << json;
+}
+
+TEST(Instrument, ChromeTrace) {
+  std::ostringstream discard;
+  instrument::WriteChromeTrace(discard);
+  instrument::SetTracing(true);
+  { instrument::Scope scope(instrument::kExpand); }
+  instrument::SetTracing(false);
+  { instrument::Scope scope(instrument::kCollect); }
+  std::ostringstream out;
+  instrument::WriteChromeTrace(out);
+  auto trace = out.str();
+  EXPECT_EQ(trace.find("{\"traceEvents\": ["), 0) << trace;
+  EXPECT_NE(trace.find("\"name\": \"expand\", \"ph\": \"X\""), trace.npos)
+      << trace;
+  EXPECT_EQ(trace.find("\"collect\""), trace.npos) << "not tracing";
+}
+
+TEST(Instrument, Macros) {
+  Collect();
+  INSTRUMENT_COUNT(kEvaluations);
+  INSTRUMENT_ADD(kEvaluations, 2);
+  { INSTRUMENT_SCOPE(kSearch); }
+  auto report = Collect();
+  // nothing is recorded unless built with -DINSTRUMENT
+  EXPECT_EQ(report.count[instrument::kEvaluations],
+            instrument::kEnabled ? 3 : 0);
+  EXPECT_EQ(report.count[instrument::kSearch], instrument::kEnabled ? 1 : 0);
+}
@@ -0,0 +1,245 @@
+#include "mcts.hh"
+
+#include <parlay/parallel.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "hash.h"
+#include "instrument.hh"
+
+namespace {
+
+// value of a line that tops out, far below any `Evaluate()`
+constexpr double kToppedOut = -1e4;
+
+void AtomicMin(std::atomic<double>& target, double value) {
+  double old = target.load(std::memory_order_relaxed);
+  while (value < old &&
+         !target.compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+  }
+}
+
+void AtomicMax(std::atomic<double>& target, double value) {
+  double old = target.load(std::memory_order_relaxed);
+  while (value > old &&
+         !target.compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+  }
+}
+
+void AtomicMax(std::atomic<int>& target, int value) {
+  int old = target.load(std::memory_order_relaxed);
+  while (value > old &&
+         !target.compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+Mcts::Mcts(Options options)
+    : options_(options),
+      nodes_(new Node[options.max_nodes + PlayerBoard::kMaxPlacements]),
+      // a node has a state only once expanded, and every playout expands at
+      // most one node
+      states_(std::min(options.max_nodes, options.iterations + 1)) {
+  assert(options_.iterations >= 1 && options_.max_nodes >= 2 &&
+         options_.rollout_samples >= 1);
+}
+
+void Mcts::Reset(Node& node, std::array<int8_t, 3> placement) {
+  node.visits.store(0, std::memory_order_relaxed);
+  node.virtual_loss.store(0, std::memory_order_relaxed);
+  node.value_sum.store(0, std::memory_order_relaxed);
+  node.expansion.store(kLeaf, std::memory_order_relaxed);
+  node.num_children = 0;
+  node.placement = placement;
+}
+
+bool Mcts::ShouldStop() const {
+  if (stop_ && stop_->load(std::memory_order_relaxed)) return true;
+  return options_.time_budget_ms > 0 && Clock::now() >= deadline_;
+}
+
+Mcts::Result Mcts::Search(const PlayerBoard& root,
+                          const std::atomic<bool>* stop) {
+  INSTRUMENT_SCOPE(kSearch);
+  stop_ = stop;
+  deadline_ = Clock::now() + std::chrono::milliseconds(options_.time_budget_ms);
+  num_nodes_ = 1;
+  num_states_ = 0;
+  min_value_ = std::numeric_limits<double>::infinity();
+  max_value_ = -std::numeric_limits<double>::infinity();
+  depth_ = 1;
+  Reset(nodes_[0], {0, 0, 0});
+  Expand(0, root);
+  assert(nodes_[0].num_children > 0 && "should have at least ONE placement");
+
+  // workers take playouts until all are taken or time is up
+  const size_t workers = options_.workers > 0 ? options_.workers
+                                              : parlay::num_workers();
+  std::atomic<size_t> next = 0, done = 0;
+  std::atomic<bool> stopped = false;
+  parlay::parallel_for(0, workers, [&](size_t) {
+    std::vector<uint32_t> path;
+    path.reserve(64);
+    while (true) {
+      const size_t i = next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= options_.iterations) break;
+      // the first playout always runs, so there is a move to return
+      if (i > 0 && ShouldStop()) {
+        stopped.store(true, std::memory_order_relaxed);
+        break;
+      }
+      Iterate(hash(options_.seed ^ hash(i)), path);
+      done.fetch_add(1, std::memory_order_relaxed);
+    }
+  }, 1);
+
+  Result result;
+  const Node& top = nodes_[0];
+  uint32_t idx = 0;
+  for (const Node* node = &top;
+       node->expansion.load(std::memory_order_acquire) == kExpanded &&
+       node->num_children > 0;) {
+    // the most visited child, ties go to the first
+    uint32_t best = node->first_child;
+    for (uint32_t c = best + 1; c < node->first_child + node->num_children;
+         ++c) {
+      if (nodes_[c].visits > nodes_[best].visits) best = c;
+    }
+    if (nodes_[best].visits == 0) break;
+    auto [x, y, d] = nodes_[best].placement;
+    result.pv.push_back({x, y, d});
+    if (node == &top) idx = best;
+    node = &nodes_[best];
+  }
+  result.placement = result.pv.front();
+  result.eval = Mean(nodes_[idx]);
+  result.stats.nodes = num_nodes_;
+  result.stats.iterations = done;
+  result.stats.depth = depth_;
+  result.stats.stopped = stopped;
+  return result;
+}
+
+void Mcts::Iterate(uint64_t seed, std::vector<uint32_t>& path) {
+  path.clear();
+  uint32_t idx = 0;
+  const PlayerBoard* parent = nullptr;
+  while (true) {
+    Node& node = nodes_[idx];
+    node.virtual_loss.fetch_add(1, std::memory_order_relaxed);
+    path.push_back(idx);
+    if (node.expansion.load(std::memory_order_acquire) != kExpanded ||
+        node.num_children == 0) {
+      break;
+    }
+    parent = &states_[node.state];
+    idx = Select(node);
+  }
+  AtomicMax(depth_, int(path.size()) - 1);
+
+  Node& leaf = nodes_[idx];
+  double value;
+  if (leaf.expansion.load(std::memory_order_acquire) == kExpanded) {
+    value = kToppedOut;  // expanded without children
+  } else {
+    PlayerBoard pb(*parent);
+    auto [x, y, d] = leaf.placement;
+    pb.SimulatePlacement(x, y, d);
+    Expand(idx, pb);
+    value = Rollout(pb, seed);
+  }
+  AtomicMin(min_value_, value);
+  AtomicMax(max_value_, value);
+  for (uint32_t i : path) {
+    Node& node = nodes_[i];
+    node.value_sum.fetch_add(value, std::memory_order_relaxed);
+    node.visits.fetch_add(1, std::memory_order_relaxed);
+    node.virtual_loss.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+void Mcts::Expand(uint32_t idx, const PlayerBoard& pb) {
+  Node& node = nodes_[idx];
+  uint8_t leaf = kLeaf;
+  if (!node.expansion.compare_exchange_strong(leaf, kExpanding,
+                                              std::memory_order_relaxed)) {
+    return;  // another worker has it
+  }
+  std::array<std::array<int, 3>, PlayerBoard::kMaxPlacements> placements;
+  const uint32_t n = pb.GeneratePlacements(placements, options_.hold);
+  const size_t first = num_nodes_.fetch_add(n, std::memory_order_relaxed);
+  // the root expands before any playout, so it never races for the room
+  // reserved for it
+  if (idx != 0 && first + n > options_.max_nodes) {
+    // the pool is full, stays a leaf for good
+    num_nodes_.fetch_sub(n, std::memory_order_relaxed);
+    return;
+  }
+  node.state = num_states_.fetch_add(1, std::memory_order_relaxed);
+  states_[node.state] = pb;
+  node.first_child = first;
+  node.num_children = n;
+  for (uint32_t i = 0; i < n; ++i) {
+    auto [x, y, d] = placements[i];
+    Reset(nodes_[first + i], {int8_t(x), int8_t(y), int8_t(d)});
+  }
+  node.expansion.store(kExpanded, std::memory_order_release);
+}
+
+double Mcts::Mean(const Node& node) const {
+  uint32_t n = node.visits.load(std::memory_order_relaxed);
+  return n ? node.value_sum.load(std::memory_order_relaxed) / n : 0;
+}
+
+uint32_t Mcts::Select(const Node& node) const {
+  const double lo = min_value_.load(std::memory_order_relaxed);
+  const double hi = max_value_.load(std::memory_order_relaxed);
+  const double range = hi > lo ? hi - lo : 1;
+  const double total = node.visits.load(std::memory_order_relaxed) +
+                       node.virtual_loss.load(std::memory_order_relaxed);
+  const double explore = options_.exploration * std::sqrt(std::log(total + 1));
+  uint32_t best = node.first_child;
+  double best_score = -std::numeric_limits<double>::infinity();
+  for (uint32_t c = node.first_child; c < node.first_child + node.num_children;
+       ++c) {
+    const Node& child = nodes_[c];
+    const uint32_t n = child.visits.load(std::memory_order_relaxed);
+    const uint32_t loss = child.virtual_loss.load(std::memory_order_relaxed);
+    // untried children first, in generation order
+    if (n + loss == 0) return c;
+    // playouts in flight count as visits with the lowest value
+    double q = n ? (Mean(child) - lo) / range * n / (n + loss) : 0;
+    double score = q + explore / std::sqrt(n + loss);
+    if (score > best_score) {
+      best_score = score;
+      best = c;
+    }
+  }
+  return best;
+}
+
+double Mcts::Rollout(PlayerBoard pb, uint64_t seed) const {
+  std::array<std::array<int, 3>, PlayerBoard::kMaxPlacements> placements;
+  for (int step = 0; step < options_.rollout_depth; ++step) {
+    const int n = pb.GeneratePlacements(placements, options_.hold);
+    if (n == 0) return kToppedOut;
+    PlayerBoard best(pb);
+    double best_eval = -std::numeric_limits<double>::infinity();
+    for (int s = 0; s < options_.rollout_samples; ++s) {
+      seed = hash(seed);
+      auto [x, y, d] = placements[seed % n];
+      PlayerBoard next(pb);
+      next.SimulatePlacement(x, y, d);
+      if (double eval = next.Evaluate(options_.weights); eval > best_eval) {
+        best_eval = eval;
+        best = next;
+      }
+    }
+    pb = best;
+  }
+  return pb.Evaluate(options_.weights);
+}
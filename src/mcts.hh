@@ -0,0 +1,115 @@
+#ifndef SRC_MCTS_HH_
+#define SRC_MCTS_HH_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "player_board.hh"
+
+/**
+ * Monte Carlo tree search over piece placements for one player, with the
+ * same interface as `BeamSearch` so the two can be compared.
+ *
+ * Workers share one tree (tree parallelism). Node statistics are relaxed
+ * atomics. A worker descending a path adds a virtual loss to every node on
+ * it, which steers the other workers elsewhere until its playout is backed
+ * up. A leaf is expanded by the first worker to claim it: all its
+ * placements become children in one block of the node pool.
+ *
+ * A playout places `rollout_depth` more pieces from the leaf, taking the
+ * pieces from the queue with `QueuePop` (a seeded 7-bag, so playouts see the
+ * same bag as the game). Each step samples `rollout_samples` placements at
+ * random and keeps the one with the best `Evaluate()`. The playout's value
+ * is the `Evaluate()` it ends on. UCT compares values normalized to the
+ * lowest and highest values seen.
+ *
+ * Nodes and states come from pools allocated once, so a search does no heap
+ * allocation after the first one.
+ */
+class Mcts {
+ public:
+  struct Options {
+    size_t iterations = 10000;  // playouts per search
+    int rollout_depth = 4;      // pieces a playout places below the leaf
+    int rollout_samples = 4;    // placements tried per playout step
+    double exploration = 0.5;   // UCT constant, values are in [0, 1]
+    // node pool size, leaves stop expanding once it is full; the root always
+    // expands, its children get room on top if they do not fit
+    size_t max_nodes = 1 << 19;
+    int workers = 0;             // 0 for `parlay::num_workers()`
+    int time_budget_ms = 0;      // when positive, stop once it runs out
+    uint64_t seed = 1;           // of the playout samples
+    EvalWeights weights;         // of every `Evaluate()`
+    // also branch on holding, see `PlayerBoard::GeneratePlacements()`
+    bool hold = false;
+  };
+
+  struct Stats {
+    size_t nodes = 0;       // nodes in the tree
+    size_t iterations = 0;  // playouts backed up
+    int depth = 0;          // pieces placed down to the deepest node
+    bool stopped = false;   // time ran out or `stop` was set before the end
+  };
+
+  struct Result {
+    std::array<int, 3> placement;  // <x,y,d> of the most visited first move
+    double eval;                   // mean playout value below `placement`
+    // most visited line of play, starting with `placement`
+    std::vector<std::array<int, 3>> pv;
+    Stats stats;
+  };
+
+  explicit Mcts(Options options);
+
+  /**
+   * @brief Searches from `root`, which must have at least one placement.
+   *
+   * @param stop if given, setting it from another thread stops the search
+   */
+  Result Search(const PlayerBoard& root,
+                const std::atomic<bool>* stop = nullptr);
+
+  const Options& options() const { return options_; }
+
+ private:
+  enum Expansion : uint8_t { kLeaf, kExpanding, kExpanded };
+
+  struct Node {
+    std::atomic<uint32_t> visits;
+    std::atomic<uint32_t> virtual_loss;  // playouts in flight through here
+    std::atomic<double> value_sum;
+    std::atomic<uint8_t> expansion;
+    // set before `expansion` becomes kExpanded
+    uint32_t first_child, num_children;
+    uint32_t state;  // index into `states_`
+    std::array<int8_t, 3> placement;  // from the parent
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  Options options_;
+  std::unique_ptr<Node[]> nodes_;
+  std::vector<PlayerBoard> states_;  // of expanded nodes only
+  std::atomic<size_t> num_nodes_, num_states_;
+  // lowest and highest playout values so far
+  std::atomic<double> min_value_, max_value_;
+  std::atomic<int> depth_;
+  Clock::time_point deadline_;
+  const std::atomic<bool>* stop_ = nullptr;
+
+  bool ShouldStop() const;
+  void Reset(Node& node, std::array<int8_t, 3> placement);
+  // one playout from the root, `path` is scratch
+  void Iterate(uint64_t seed, std::vector<uint32_t>& path);
+  // claims `idx` and adds its children if no other worker did
+  void Expand(uint32_t idx, const PlayerBoard& pb);
+  uint32_t Select(const Node& node) const;
+  double Rollout(PlayerBoard pb, uint64_t seed) const;
+  double Mean(const Node& node) const;
+};
+
+#endif  // SRC_MCTS_HH_
@@ -0,0 +1,105 @@
+#include "mcts.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "test_util.hh"
+
+namespace {
+
+using test_util::TestBoard;
+
+// plays `pv` from `pb`, checking every move is legal where it is played
+void ExpectLegal(PlayerBoard pb, const std::vector<std::array<int, 3>>& pv) {
+  for (size_t i = 0; i < pv.size(); ++i) {
+    auto placements = pb.GeneratePlacements();
+    ASSERT_NE(std::find(placements.begin(), placements.end(), pv[i]),
+              placements.end())
+        << "move " << i;
+    auto [x, y, d] = pv[i];
+    pb.SimulatePlacement(x, y, d);
+  }
+}
+
+}  // namespace
+
+TEST(Mcts, Search) {
+  Mcts search({.iterations = 2000, .workers = 1});
+  PlayerBoard pb = TestBoard();
+  for (int i = 0; i < 4; ++i) {
+    auto result = search.Search(pb);
+    EXPECT_EQ(result.stats.iterations, 2000) << "move " << i;
+    EXPECT_FALSE(result.stats.stopped);
+    ASSERT_FALSE(result.pv.empty());
+    EXPECT_EQ(result.pv.front(), result.placement);
+    EXPECT_LE(result.pv.size(), result.stats.depth);
+    EXPECT_GT(result.stats.depth, 1) << "the tree grows below the root";
+    ExpectLegal(pb, result.pv);
+    auto [x, y, d] = result.placement;
+    pb.SimulatePlacement(x, y, d);
+  }
+}
+
+TEST(Mcts, Deterministic) {
+  // with one worker the same seed gives the same tree
+  Mcts::Options options{.iterations = 1000, .workers = 1, .seed = 7};
+  Mcts a(options), b(options);
+  auto ra = a.Search(TestBoard());
+  auto rb = b.Search(TestBoard());
+  EXPECT_EQ(ra.pv, rb.pv);
+  EXPECT_EQ(ra.eval, rb.eval);
+  EXPECT_EQ(ra.stats.nodes, rb.stats.nodes);
+  // and the pools are reset between searches
+  auto again = a.Search(TestBoard());
+  EXPECT_EQ(again.pv, ra.pv);
+  EXPECT_EQ(again.stats.nodes, ra.stats.nodes);
+}
+
+TEST(Mcts, FullPool) {
+  Mcts search({.iterations = 1000, .max_nodes = 200, .workers = 1});
+  auto result = search.Search(TestBoard());
+  EXPECT_EQ(result.stats.iterations, 1000) << "playouts go on from leaves";
+  EXPECT_LE(result.stats.nodes, 200);
+  ExpectLegal(TestBoard(), result.pv);
+}
+
+TEST(Mcts, PoolSmallerThanRoot) {
+  PlayerBoard root = TestBoard();
+  const size_t branching = root.GeneratePlacements().size();
+  ASSERT_GT(branching, 16);
+  auto result = Mcts({.iterations = 10, .max_nodes = 16, .workers = 1})
+                    .Search(root);
+  EXPECT_EQ(result.stats.iterations, 10);
+  EXPECT_EQ(result.stats.nodes, 1 + branching) << "only the root expands";
+  EXPECT_EQ(result.pv.size(), 1);
+  ExpectLegal(root, result.pv);
+}
+
+TEST(Mcts, Stop) {
+  Mcts::Options options{.iterations = 1000000, .time_budget_ms = 5};
+  Mcts search(options);
+  auto result = search.Search(TestBoard());
+  EXPECT_TRUE(result.stats.stopped);
+  EXPECT_LT(result.stats.iterations, options.iterations);
+  ExpectLegal(TestBoard(), result.pv);
+
+  // a stop flag set up front still leaves one playout to pick a move
+  std::atomic<bool> stop = true;
+  result = Mcts({.iterations = 1000}).Search(TestBoard(), &stop);
+  EXPECT_TRUE(result.stats.stopped);
+  EXPECT_EQ(result.stats.iterations, 1);
+  ExpectLegal(TestBoard(), {result.placement});
+}
+
+TEST(Mcts, Workers) {
+  Mcts search({.iterations = 4000, .workers = 4});
+  PlayerBoard pb = TestBoard();
+  for (int i = 0; i < 3; ++i) {
+    auto result = search.Search(pb);
+    EXPECT_EQ(result.stats.iterations, 4000) << "move " << i;
+    ExpectLegal(pb, result.pv);
+    auto [x, y, d] = result.placement;
+    pb.SimulatePlacement(x, y, d);
+  }
+}
@@ -1,17 +1,34 @@
 #ifndef SRC_PIECES_HH_
 #define SRC_PIECES_HH_
 
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
-#include <sstream>
-#include <vector>
+#include <string_view>
 
 #include "board.hh"
 
 class Piece {
  public:
+  // every orientation fits in the bottom `kBox` rows of its string, with its
+  // leftmost cell in the first `kBox` columns
+  constexpr static int kBox = 4;
+  // smallest horizontal offset a piece can be placed at
+  constexpr static int kMinX = 1 - kBox;
+  // number of horizontal offsets with a precomputed mask
+  constexpr static int kOffsets = Board::width - kMinX;
+
+  /**
+   * Occupied cells of one orientation, bounds are inclusive on both ends.
+   */
+  struct Extent {
+    int left = Board::width, right = -1;
+    int bottom = Board::height, top = -1;
+  };
+
   /**
-   * @brief Construct a new Piece object.
+   * @brief Construct a new Piece object, usable at compile time.
    *
    * @param name
    * @param sn string for north
@@ -19,13 +36,28 @@ class Piece {
    * @param ss string for south
    * @param sw string for west
    */
-  Piece(const std::string& name, const std::string& sn, const std::string& se,
-        const std::string& ss, const std::string& sw) {
-    name_ = name;
-    LoadString(nesw_[0], sn);
-    LoadString(nesw_[1], se);
-    LoadString(nesw_[2], ss);
-    LoadString(nesw_[3], sw);
+  constexpr Piece(const char* name, std::string_view sn, std::string_view se,
+                  std::string_view ss, std::string_view sw)
+      : name_(name) {
+    LoadString(0, sn);
+    LoadString(1, se);
+    LoadString(2, ss);
+    LoadString(3, sw);
+    for (int d = 0; d < 4; ++d) {
+      shapes_[d] = d;
+      for (int e = 0; e < d; ++e) {
+        if (SameShape(d, e)) {
+          shapes_[d] = shapes_[e];
+          break;
+        }
+      }
+      for (int x = kMinX; x < Board::width; ++x) {
+        for (int i = 0; i < kBox; ++i) {
+          shifted_[d][x - kMinX][i] =
+              x >= 0 ? nesw_[d][i] << x : nesw_[d][i] >> -x;
+        }
+      }
+    }
   }
 
   /**
@@ -39,206 +71,212 @@ class Piece {
    * @return `true` if you cannot place it, either because there is an
    * intersection, OR the placement is off the board.
    */
-  bool Intersects(const Board& board, int dx, int dy, int direction) const {
-    if (dx < 0) return true;
-    if (dy + y_offset_ < 0) return true;
-    // std::cout << "dy=" << dy << "; h=" << height_ << "; bh=" << Board::height
-    // << "\n";
-    if (dx + width_ >= Board::width) return true;
-    if (dy + height_ >= Board::height) return true;
-    int offset = (dx + Board::width * dy);
-    auto mask = nesw_[direction];
-    if (offset > 0) {
-      mask <<= offset;
-    } else {
-      mask >>= -offset;
-    }
-    /// TODO: fix vertical out-of-bounds (not this scuffed implementation)
-    auto mmask = mask;
-    if (offset > 0) {
-      mmask >>= offset;
-    } else {
-      mmask <<= -offset;
+  constexpr bool Intersects(const Board& board, int dx, int dy,
+                            int direction) const {
+    const auto& extent = extents_[direction];
+    if (dx + extent.left < 0) return true;
+    if (dx + extent.right >= Board::width) return true;
+    if (dy + extent.bottom < 0) return true;
+    if (dy + extent.top >= Board::height) return true;
+    const auto& mask = shifted_[direction][dx - kMinX];
+    for (int i = extent.bottom; i <= extent.top; ++i) {
+      if (board.grid.row(dy + i) & mask[i]) return true;
     }
-    if (mmask != nesw_[direction]) return true;  // its off the board
-
-    // std::cout << "yoffset" << y_offset_ << " ? " << (dy + (int)y_offset_)
-    //           << "\n";
-    // std::cout << "<< " << (dx + Board::width * dy) << "\n";
-    // Board b;
-    // b.grid = board.grid; std::cout << "board" << b << "\n";
-    // b.grid = mask; std::cout << "mask" << b << "\n";
-    return (board.grid & mask).any();
+    return false;
   }
 
-  void Place(Board& board, int dx, int dy, int direction) const {
-    assert(dx >= 0 && "Invalid offset");
-    // assert(dy + y_offset_ >= 0 && "Invalid offset"); // This is broken?
-    assert(dx + width_ < Board::width && "Invalid offset");
-    assert(dy + height_ <= Board::height && "Invalid offset");
-    int offset = (dx + Board::width * dy);
-    auto mask = nesw_[direction];
-    if (offset > 0) {
-      mask <<= offset;
-    } else {
-      mask >>= -offset;
+  /**
+   * @brief Places the piece onto the board without any collision checks.
+   *
+   * @return the number of cells that were newly filled
+   */
+  int Place(Board& board, int dx, int dy, int direction) const {
+    const auto& extent = extents_[direction];
+    assert(dx + extent.left >= 0 && "Invalid offset");
+    assert(dx + extent.right < Board::width && "Invalid offset");
+    assert(dy + extent.bottom >= 0 && "Invalid offset");
+    assert(dy + extent.top < Board::height && "Invalid offset");
+    const auto& mask = shifted_[direction][dx - kMinX];
+    int added = 0;
+    for (int i = extent.bottom; i <= extent.top; ++i) {
+      added += std::popcount<Board::Row>(mask[i] & ~board.grid.row(dy + i));
+      board.OrRow(dy + i, mask[i]);
     }
-    board.grid |= mask;
-    // Board b;
-    // std::cout << "dxy= " << dx << "," << dy << "\n";
-    // std::cout << "yo= " << y_offset_ << "\n";
-    // std::cout << "wh= " << width_ << "," << height_ << "\n";
-    // b.grid = nesw_[direction]; std::cout << "pre" << b << "\n";
-    // b.grid = mask; std::cout << "post" << b << "\n";
+    return added;
   }
   size_t width() const { return width_; }
   size_t height() const { return height_; }
+  // rows of each orientation from the bottom up, bit `j` is column `j`
   const auto& nesw() const { return nesw_; }
-  const std::string& name() const { return name_; }
+  const Extent& extent(int direction) const { return extents_[direction]; }
+  /**
+   * @brief Identifies orientations that cover the same cells up to
+   * translation (e.g. all four for O).
+   *
+   * @return the lowest orientation with the same shape as `direction`
+   */
+  int shape(int direction) const { return shapes_[direction]; }
+  const char* name() const { return name_; }
 
  private:
-  int y_offset_;
-  size_t width_, height_;
-  std::array<Board::Grid, 4> nesw_;
-  std::string name_;
-
-  void LoadString(Board::Grid& grid, const std::string& s) {
-    std::vector<std::string> g;
-    std::istringstream in(s);
-    std::string line;
-    while (in >> line) g.push_back(line);
-    grid ^= grid;  // clear
-    size_t firsti = Board::height;
-    int first_width = -1;
+  typedef std::array<Board::Row, kBox> Mask;
+
+  size_t width_ = 0, height_ = 0;
+  std::array<Mask, 4> nesw_{};
+  // `nesw_` pre-shifted to every horizontal offset in [kMinX, Board::width)
+  std::array<std::array<Mask, kOffsets>, 4> shifted_{};
+  std::array<Extent, 4> extents_{};
+  std::array<int, 4> shapes_{};
+  const char* name_;
+
+  constexpr bool SameShape(int a, int b) const {
+    const auto &ea = extents_[a], &eb = extents_[b];
+    if (ea.top - ea.bottom != eb.top - eb.bottom) return false;
+    for (int i = 0; i <= ea.top - ea.bottom; ++i) {
+      if (nesw_[a][ea.bottom + i] >> ea.left !=
+          nesw_[b][eb.bottom + i] >> eb.left) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  constexpr static bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+  }
+
+  constexpr void LoadString(int d, std::string_view s) {
+    std::array<std::string_view, kBox> g{};
+    size_t n = 0;
+    for (size_t i = 0, j = 0; i < s.size(); i = j) {
+      while (i < s.size() && IsSpace(s[i])) ++i;
+      for (j = i; j < s.size() && !IsSpace(s[j]);) ++j;
+      if (i == j) continue;
+      assert(n < g.size() && "Piece should be at most kBox rows tall.");
+      g[n++] = s.substr(i, j - i);
+    }
+    auto& extent = extents_[d];
+    extent = Extent();
     width_ = 0;
     height_ = 0;
-    for (size_t i = 0; i < g.size(); ++i) {
+    for (size_t i = 0; i < n; ++i) {
+      assert(g[i].size() == g[0].size() &&
+             "Input should be a n x m rectangle.");
       for (size_t j = 0; j < g[i].size(); ++j) {
-        assert(i * Board::width + j < grid.size() &&
-               "Input shouldn't go out of bounds.");
-        if (g[g.size() - 1 - i][j] == '#') {  // flip vertically (storage)
-          grid[i * Board::width + j] = 1;
-          height_ = std::max(height_, g.size() - 1 - i);
+        assert(j < (size_t)Board::width && "Input shouldn't go out of bounds.");
+        if (g[n - 1 - i][j] == '#') {  // flip vertically (storage)
+          nesw_[d][i] |= Board::Row(1) << j;
+          height_ = std::max(height_, n - 1 - i);
           width_ = std::max(width_, j);
-          firsti = std::min(firsti, g.size() - i);
+          extent.left = std::min(extent.left, (int)j);
+          extent.right = std::max(extent.right, (int)j);
+          extent.bottom = std::min(extent.bottom, (int)i);
+          extent.top = std::max(extent.top, (int)i);
         }
       }
-      if (first_width == -1) {
-        first_width = line.size();
-      } else {
-        assert(first_width == (int)line.size() &&
-               "Input should be a n x m rectangle.");
-      }
     }
-    // alignment
-    // int dx = 0;
-    // int dy = firsti;
-    y_offset_ = height_ - firsti;
-    // Board b;
-    // std::cout << "dy=" << dy << "\n";
-    // b.grid = grid; std::cout << b << "\n";
-    // grid >>= (dx + Board::width * dy);
-    // b.grid = grid; std::cout << b << "\n";
+    assert(extent.left < kBox && "Piece should start in the first kBox columns.");
   }
 };
 
 namespace pieces {
 
-const static Piece J("J",
-                     "#..\n"
-                     "###\n"
-                     "...",
-                     "...\n"
-                     "###\n"
-                     "#..",
-                     "##.\n"
-                     ".#.\n"
-                     ".#.",
-                     ".#.\n"
-                     ".#.\n"
-                     "##.");
-const static Piece L("L",
-                     "..#\n"
-                     "###\n"
-                     "...",
-                     ".#.\n"
-                     ".#.\n"
-                     ".##",
-                     "...\n"
-                     "###\n"
-                     "#..",
-                     "##.\n"
-                     ".#.\n"
-                     ".#.");
-const static Piece S("S",
-                     ".##\n"
-                     "##.\n"
-                     "...",
-                     ".#.\n"
-                     ".##\n"
-                     "..#",
-                     "...\n"
-                     ".##\n"
-                     "##.",
-                     "#..\n"
-                     "##.\n"
-                     ".#.");
-const static Piece Z("Z",
-                     "##.\n"
-                     ".##\n"
-                     "...",
-                     "..#\n"
-                     ".##\n"
-                     ".#.",
-                     "...\n"
-                     "##.\n"
-                     ".##",
-                     ".#.\n"
-                     "##.\n"
-                     "#..");
-const static Piece O("O",
-                     "##\n"
-                     "##",
-                     "##\n"
-                     "##",
-                     "##\n"
-                     "##",
-                     "##\n"
-                     "##");
-const static Piece I("I",
-                     "....\n"
-                     "####\n"
-                     "....\n"
-                     "....",
-                     "..#.\n"
-                     "..#.\n"
-                     "..#.\n"
-                     "..#.",
-                     "....\n"
-                     "....\n"
-                     "####\n"
-                     "....",
-                     ".#..\n"
-                     ".#..\n"
-                     ".#..\n"
-                     ".#..");
-const static Piece T("T",
-                     ".#.\n"
-                     "###\n"
-                     "...",
-                     ".#.\n"
-                     ".##\n"
-                     ".#.",
-                     "...\n"
-                     "###\n"
-                     ".#.",
-                     ".#.\n"
-                     "##.\n"
-                     ".#.");
-const static Piece Line10("10", "##########", "##########", "##########",
-                          "##########");
-const static std::vector<const Piece*> kAll7 = {&J, &T, &L, &S, &Z, &I, &O};
+inline constexpr Piece J("J",
+                         "#..\n"
+                         "###\n"
+                         "...",
+                         "...\n"
+                         "###\n"
+                         "#..",
+                         "##.\n"
+                         ".#.\n"
+                         ".#.",
+                         ".#.\n"
+                         ".#.\n"
+                         "##.");
+inline constexpr Piece L("L",
+                         "..#\n"
+                         "###\n"
+                         "...",
+                         ".#.\n"
+                         ".#.\n"
+                         ".##",
+                         "...\n"
+                         "###\n"
+                         "#..",
+                         "##.\n"
+                         ".#.\n"
+                         ".#.");
+inline constexpr Piece S("S",
+                         ".##\n"
+                         "##.\n"
+                         "...",
+                         ".#.\n"
+                         ".##\n"
+                         "..#",
+                         "...\n"
+                         ".##\n"
+                         "##.",
+                         "#..\n"
+                         "##.\n"
+                         ".#.");
+inline constexpr Piece Z("Z",
+                         "##.\n"
+                         ".##\n"
+                         "...",
+                         "..#\n"
+                         ".##\n"
+                         ".#.",
+                         "...\n"
+                         "##.\n"
+                         ".##",
+                         ".#.\n"
+                         "##.\n"
+                         "#..");
+inline constexpr Piece O("O",
+                         "##\n"
+                         "##",
+                         "##\n"
+                         "##",
+                         "##\n"
+                         "##",
+                         "##\n"
+                         "##");
+inline constexpr Piece I("I",
+                         "....\n"
+                         "####\n"
+                         "....\n"
+                         "....",
+                         "..#.\n"
+                         "..#.\n"
+                         "..#.\n"
+                         "..#.",
+                         "....\n"
+                         "....\n"
+                         "####\n"
+                         "....",
+                         ".#..\n"
+                         ".#..\n"
+                         ".#..\n"
+                         ".#..");
+inline constexpr Piece T("T",
+                         ".#.\n"
+                         "###\n"
+                         "...",
+                         ".#.\n"
+                         ".##\n"
+                         ".#.",
+                         "...\n"
+                         "###\n"
+                         ".#.",
+                         ".#.\n"
+                         "##.\n"
+                         ".#.");
+inline constexpr Piece Line10("10", "##########", "##########", "##########",
+                              "##########");
+inline constexpr std::array<const Piece*, 7> kAll7 = {&J, &T, &L, &S,
+                                                      &Z, &I, &O};
 
 }  // namespace pieces
 
-#endif  // SRC_PIECES_HH_
\ No newline at end of file
+#endif  // SRC_PIECES_HH_
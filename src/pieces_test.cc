@@ -27,4 +27,25 @@ TEST(Pieces, Intersect) {
     EXPECT_TRUE(pieces::O.Intersects(b, 1, 0, (d + 3) % 3))
         << "Should overlap";
   }
-}
\ No newline at end of file
+}
+
+TEST(Pieces, CompileTime) {
+  static_assert(!pieces::T.Intersects(Board(), 3, 0, 0),
+                "collision tables are built at compile time");
+  static_assert(pieces::T.Intersects(Board(), Board::width - 2, 0, 0),
+                "off the right wall");
+  static_assert(!pieces::I.Intersects(Board(), -1, 0, 3),
+                "vertical I can reach column 0");
+  Board b;
+  pieces::Line10.Place(b, 0, 0, 0);
+  EXPECT_TRUE(b.IsRowFull(0));
+}
+
+TEST(Pieces, Shapes) {
+  for (int d = 0; d < 4; ++d) {
+    EXPECT_EQ(pieces::O.shape(d), 0) << "O looks the same in every direction";
+    EXPECT_EQ(pieces::T.shape(d), d) << "T looks different in every direction";
+  }
+  EXPECT_EQ(pieces::I.shape(2), 0);
+  EXPECT_EQ(pieces::S.shape(3), 1);
+}
@@ -1,66 +1,317 @@
 #include "player_board.hh"
 
+#include <parlay/parallel.h>
+
+#include <algorithm>
 #include <array>
-#include <set>
-#include <unordered_set>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <sstream>
 #include <vector>
 
 #include "hash.h"
+#include "instrument.hh"
+#include "transposition_table.hh"
+#include "zobrist.hh"
+
+namespace {
+
+constexpr int kSpawnY = 20;
+
+int PieceId(const Piece* piece) {
+  auto it = std::find(pieces::kAll7.begin(), pieces::kAll7.end(), piece);
+  assert(it != pieces::kAll7.end() && "one of the 7 pieces");
+  return it - pieces::kAll7.begin();
+}
+
+// raises `target` to at least `value`, safe to call concurrently
+void AtomicMax(std::atomic<int>& target, int value) {
+  int old = target.load(std::memory_order_relaxed);
+  while (old < value &&
+         !target.compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+  }
+}
+
+int SpawnX(const Piece& piece) {
+  return (Board::width - piece.width() - 2) / 2;
+}
+
+/**
+ * Kick offsets tried in order when rotating out of north, see
+ * https://harddrop.com/wiki/SRS. Other orientations flip the signs, see
+ * `KickOffset`.
+ *
+ * 0->1	( 0, 0)	(-1, 0)	(-1,+1)	( 0,-2)	(-1,-2)
+ * 1->2	( 0, 0)	(+1, 0)	(+1,-1)	( 0,+2)	(+1,+2)
+ * 2->3	( 0, 0)	(+1, 0)	(+1,+1)	( 0,-2)	(+1,-2)
+ * 3->0	( 0, 0)	(-1, 0)	(-1,-1)	( 0,+2)	(-1,+2)
+ */
+constexpr std::array<std::array<int, 2>, 5> kKicksCW = {{
+    {0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2},
+}};
+/**
+ * 0->3	( 0, 0)	(+1, 0)	(+1,+1)	( 0,-2)	(+1,-2)
+ * 1->0	( 0, 0)	(+1, 0)	(+1,-1)	( 0,+2)	(+1,+2)
+ * 2->1	( 0, 0)	(-1, 0)	(-1,+1)	( 0,-2)	(-1,-2)
+ * 3->2	( 0, 0)	(-1, 0)	(-1,-1)	( 0,+2)	(-1,+2)
+ */
+constexpr std::array<std::array<int, 2>, 5> kKicksCCW = {{
+    {0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2},
+}};
+
+// applies the orientation dependent sign flips to a kick offset
+constexpr std::array<int, 2> KickOffset(std::array<int, 2> kick, int from) {
+  auto [dx, dy] = kick;
+  if (from == 1 || from == 2) dx *= -1;
+  if (from == 1 || from == 3) dy *= -1;
+  return {dx, dy};
+}
+
+/**
+ * Set of positions (x, y) of one piece orientation. Pieces live in a 4x4 box
+ * that may hang off the left and bottom edges, so position (x, y) is bit
+ * `x + kPad` of row `y + kPad`.
+ */
+struct PositionMap {
+  constexpr static int kPad = 3;
+  constexpr static int kRows = Board::height + kPad;
+  constexpr static uint16_t kRowMask = (1 << (Board::width + kPad)) - 1;
+
+  std::array<uint16_t, kRows> rows{};
+
+  bool test(int x, int y) const { return (rows[y + kPad] >> (x + kPad)) & 1; }
+  void set(int x, int y) { rows[y + kPad] |= 1 << (x + kPad); }
+  bool operator==(const PositionMap&) const = default;
+};
+
+/**
+ * @brief Builds the map of positions where `piece` facing `d` does not
+ * collide with `board` or the walls, one row of positions at a time.
+ */
+PositionMap Fits(const Board& board, const Piece& piece, int d) {
+  constexpr int kPad = PositionMap::kPad;
+  // board row with walls, cell (x, r) is bit `x + kPad`
+  auto walled = [&](int r) -> uint32_t {
+    if (r < 0 || r >= Board::height) return ~0u;
+    return (uint32_t(board.grid.row(r)) << kPad) | ((1u << kPad) - 1) |
+           (~0u << (Board::width + kPad));
+  };
+  const auto& extent = piece.extent(d);
+  const auto& mask = piece.nesw()[d];
+  PositionMap fits;
+  for (int y = -extent.bottom; y + extent.top < Board::height; ++y) {
+    uint32_t collide = 0;
+    for (int i = extent.bottom; i <= extent.top; ++i) {
+      uint32_t row = walled(y + i);
+      for (Board::Row cells = mask[i]; cells; cells &= cells - 1) {
+        collide |= row >> std::countr_zero(cells);
+      }
+    }
+    fits.rows[y + kPad] = ~collide & PositionMap::kRowMask;
+  }
+  // a row of `Board::width + kPad` positions is tested at once
+  INSTRUMENT_ADD(kCollisionTests, (Board::height - extent.top +
+                                   extent.bottom) * (Board::width + kPad));
+  return fits;
+}
+
+/**
+ * @brief Slides every position in `reach` left/right and drops it to where it
+ * lands, staying inside `fits`.
+ */
+void SlideAndDrop(PositionMap& reach, const PositionMap& fits) {
+  for (int r = 0; r < PositionMap::kRows; ++r) {
+    uint16_t x = reach.rows[r];
+    for (uint16_t prev = 0; x != prev;) {
+      prev = x;
+      x = (x | (x << 1) | (x >> 1)) & fits.rows[r];
+    }
+    reach.rows[r] = x;
+  }
+  // only the landing spot is reachable, the cells passed through are not
+  uint16_t falling = 0;
+  for (int r = PositionMap::kRows - 1; r >= 0; --r) {
+    falling |= reach.rows[r];
+    uint16_t land = falling & ~(r ? fits.rows[r - 1] : 0);
+    reach.rows[r] |= land;
+    falling &= ~land;
+  }
+}
+
+/**
+ * @brief Rotates every position of `from` into `to`, taking the first kick
+ * that fits for each position.
+ */
+void Rotate(const PositionMap& from, int d, PositionMap& to,
+            const PositionMap& to_fits,
+            const std::array<std::array<int, 2>, 5>& kicks) {
+  PositionMap left = from;  // positions that have not kicked yet
+  for (auto kick : kicks) {
+    auto [dx, dy] = KickOffset(kick, d);
+    for (int r = std::max(0, -dy); r < std::min(PositionMap::kRows,
+                                                PositionMap::kRows - dy);
+         ++r) {
+      uint16_t target = to_fits.rows[r + dy];
+      uint16_t hit = left.rows[r] & (dx >= 0 ? target >> dx : target << -dx);
+      left.rows[r] &= ~hit;
+      to.rows[r + dy] |= dx >= 0 ? hit << dx : hit >> -dx;
+    }
+  }
+}
+
+/**
+ * @brief Writes the placements of `piece` on `board` to `out`, see
+ * `PlayerBoard::GeneratePlacements()`.
+ */
+int Generate(const Board& board, const Piece& piece,
+             std::span<std::array<int, 3>> out) {
+  std::array<PositionMap, 4> fits, reach;
+  for (int d = 0; d < 4; ++d) fits[d] = Fits(board, piece, d);
+
+  if (!fits[0].test(SpawnX(piece), kSpawnY)) return 0;  // topped out
+  reach[0].set(SpawnX(piece), kSpawnY);
+
+  // flood fill over left/right/drop/rotate until nothing new is reachable
+  for (bool changed = true; changed;) {
+    auto before = reach;
+    for (int d = 0; d < 4; ++d) {
+      SlideAndDrop(reach[d], fits[d]);
+      Rotate(reach[d], d, reach[(d + 1) % 4], fits[(d + 1) % 4], kKicksCW);
+      Rotate(reach[d], d, reach[(d + 3) % 4], fits[(d + 3) % 4], kKicksCCW);
+    }
+    changed = !(before == reach);
+  }
+
+  // orientations with the same cells up to translation give duplicate
+  // placements, keep the first in (x, y, d) order
+  std::array<Board::Grid, 4> seen;
+  size_t n = 0;
+  for (int x = -PositionMap::kPad; x < Board::width; ++x) {
+    for (int y = -PositionMap::kPad; y < Board::height; ++y) {
+      for (int d = 0; d < 4; ++d) {
+        if (!reach[d].test(x, y)) continue;
+        if (y + PositionMap::kPad > 0 && fits[d].test(x, y - 1)) continue;
+        const auto& extent = piece.extent(d);
+        int cell = (y + extent.bottom) * Board::width + (x + extent.left);
+        auto& shape_seen = seen[piece.shape(d)];
+        if (shape_seen[cell]) continue;
+        shape_seen.set(cell);
+        if (n < out.size()) out[n] = {x, y, d};
+        ++n;
+      }
+    }
+  }
+  return n;
+}
+
+/**
+ * Placements of recent (grid, piece) pairs of one thread, direct mapped by
+ * the zobrist key of the grid. A slot is only used for the exact grid, so the
+ * placements are the same as generating them again, in the same order.
+ */
+struct PlacementCache {
+  constexpr static int kSlots = 512;
+  // pieces with more placements are not kept
+  constexpr static int kMaxKept = 64;
+
+  struct Slot {
+    Board::Grid grid;
+    uint8_t tag = 0;  // 1 + id of the piece, 0 while empty
+    uint8_t size = 0;
+    std::array<std::array<int8_t, 3>, kMaxKept> placements{};
+  };
+  std::array<Slot, kSlots> slots;
+};
+
+/**
+ * @brief `Generate()` for piece `id`, from the cache of this thread if it has
+ * them. `grid_key` is the zobrist key of the grid of `board`.
+ */
+int PiecePlacements(const Board& board, uint64_t grid_key, int id,
+                    std::span<std::array<int, 3>> out) {
+  thread_local PlacementCache cache;
+  auto& slot = cache.slots[hash(grid_key ^ id) % PlacementCache::kSlots];
+  if (slot.tag == id + 1 && slot.grid == board.grid) {
+    INSTRUMENT_COUNT(kPlacementsShared);
+    const int n = std::min<int>(slot.size, out.size());
+    for (int i = 0; i < n; ++i) {
+      auto [x, y, d] = slot.placements[i];
+      out[i] = {x, y, d};
+    }
+    return slot.size;
+  }
+  const int n = Generate(board, *pieces::kAll7[id], out);
+  if (n <= PlacementCache::kMaxKept && n <= int(out.size())) {
+    slot.grid = board.grid;
+    slot.tag = id + 1;
+    slot.size = n;
+    for (int i = 0; i < n; ++i) {
+      auto [x, y, d] = out[i];
+      slot.placements[i] = {int8_t(x), int8_t(y), int8_t(d)};
+    }
+  }
+  return n;
+}
+
+}  // namespace
 
 PlayerBoard::PlayerBoard() {
   // populate the first 7
   piece_queue_index_ = 0;
-  piece_queue_[0] = &pieces::I;
-  piece_queue_[1] = &pieces::J;
-  piece_queue_[2] = &pieces::L;
-  piece_queue_[3] = &pieces::O;
-  piece_queue_[4] = &pieces::S;
-  piece_queue_[5] = &pieces::T;
-  piece_queue_[6] = &pieces::Z;
-  queue_curr_ = piece_queue_;
-  queue_next_ = piece_queue_ + 7;
+  piece_queue_ = 0;
+  const Piece* first[] = {&pieces::I, &pieces::J, &pieces::L, &pieces::O,
+                          &pieces::S, &pieces::T, &pieces::Z};
+  for (int i = 0; i < 7; ++i) set_queue_at(i, PieceId(first[i]));
+  queue_curr_ = 0;
   // Note: next set will be generated on pop
+  queue_rng_ = garbage_rng_ = 0;
 
   // initialize `current_piece_`
-  QueuePop(); // current_piece_ = piece_queue_[0];
+  current_piece_ = queue_at(0);
+  hold_ = kEmptyHold;
+  spin_ = false;
   ResetPosition();
+  key_ = ComputeKey();
 }
 
 PlayerBoard::PlayerBoard(uint64_t seed) : PlayerBoard() {
   garbage_rng_ = queue_rng_ = seed;
 }
 
-PlayerBoard::PlayerBoard(const PlayerBoard& other) {
-  board_ = other.board_;
-
-  current_piece_ = other.current_piece_;
-  px_ = other.px_;
-  py_ = other.py_;
-  pd_ = other.pd_;
-  spin_ = other.spin_;
-
-  for (int i = 0; i < 14; ++i) piece_queue_[i] = other.piece_queue_[i];
-  piece_queue_index_ = other.piece_queue_index_;
-  queue_curr_ = other.queue_curr_;
-  queue_next_ = other.queue_next_;
-
-  garbage_rng_ = other.garbage_rng_;
-  queue_rng_ = other.queue_rng_;
+void PlayerBoard::set_current_piece(const Piece* piece) {
+  current_piece_ = PieceId(piece);
+}
 
-  attack_ = other.attack_;
-  b2b_ = other.b2b_;
-  combo_ = other.combo_;
-  lines_ = other.lines_;
+void PlayerBoard::set_hold_piece(const Piece* piece) {
+  key_ ^= zobrist::Hold(hold_);
+  hold_ = piece ? PieceId(piece) : kEmptyHold;
+  key_ ^= zobrist::Hold(hold_);
 }
 
 void PlayerBoard::LoadBoard(const std::string& s) {
-  // std::istringstream in(s);
-  // std::vector<std::string> g;
-  // std::string line;
-  // while (in >> line) g.push_back(line);
+  std::istringstream in(s);
+  std::vector<std::string> g;
+  std::string line;
+  while (in >> line) g.push_back(line);
+  assert(g.size() <= (size_t)Board::height && "Input shouldn't go out of bounds.");
   board_.Clear();
-  Piece p("", s, "#", "#", "#");
-  p.Place(board_, 0, p.height(), 0);
+  for (size_t i = 0; i < g.size(); ++i) {
+    Board::Row row = 0;
+    for (size_t j = 0; j < g[i].size(); ++j) {
+      assert(j < (size_t)Board::width && "Input shouldn't go out of bounds.");
+      if (g[i][j] == '#') row |= Board::Row(1) << j;
+    }
+    board_.OrRow(g.size() - 1 - i, row);  // flip vertically (storage)
+  }
+  stats_ = board_.ComputeStats();
+  key_ = ComputeKey();
+}
+
+uint64_t PlayerBoard::ComputeKey() const {
+  return zobrist::Grid(board_.grid) ^
+         zobrist::QueueIndex(piece_queue_index_) ^ zobrist::Hold(hold_) ^
+         zobrist::B2b(b2b_) ^ zobrist::Combo(combo_);
 }
 
 void PlayerBoard::SetQueue(std::vector<const Piece*> pieces) {
@@ -68,38 +319,57 @@ void PlayerBoard::SetQueue(std::vector<const Piece*> pieces) {
   assert(pieces.size() <= 7 && "no more than 7 pieces set");
   piece_queue_index_ = 0;
   for (size_t i = 1; i < pieces.size(); ++i) {
-    piece_queue_[i - 1] = pieces[i];
+    set_queue_at(i - 1, PieceId(pieces[i]));
   }
-  current_piece_ = pieces[0];
-  queue_curr_ = piece_queue_;
-  queue_next_ = piece_queue_ + 7;
+  current_piece_ = PieceId(pieces[0]);
+  queue_curr_ = 0;
+  key_ = ComputeKey();
 }
 
 const Piece* PlayerBoard::QueuePop() {
+  return pieces::kAll7[QueuePopId()];
+}
+
+int PlayerBoard::QueuePopId() {
   if (piece_queue_index_ == 0 || piece_queue_index_ == 7) RefreshQueue();
+  key_ ^= zobrist::QueueIndex(piece_queue_index_);
   if (piece_queue_index_ == 14) piece_queue_index_ = 0;
-  return piece_queue_[piece_queue_index_++];
+  int id = queue_at(piece_queue_index_++);
+  key_ ^= zobrist::QueueIndex(piece_queue_index_);
+  return id;
 }
 
 void PlayerBoard::RefreshQueue() {
-  for (size_t i = 0; i < 7; ++i) {
-    queue_next_[i] = queue_curr_[i];
+  int curr = queue_curr_, next = 7 - queue_curr_;
+  for (int i = 0; i < 7; ++i) {
+    set_queue_at(next + i, queue_at(curr + i));
   }
   // knuth shuffle using queue_rng
-  for (size_t i = 7 - 1; i >= 1; --i) {
-    size_t j = queue_rng_ % i;
-    std::swap(queue_next_[i], queue_next_[j]);
+  for (int i = 7 - 1; i >= 1; --i) {
+    int j = queue_rng_ % i;
+    int a = queue_at(next + i), b = queue_at(next + j);
+    set_queue_at(next + i, b);
+    set_queue_at(next + j, a);
     queue_rng_ = hash(queue_rng_);
   }
-  std::swap(queue_next_, queue_curr_);
+  queue_curr_ = next;
 }
 
 void PlayerBoard::ResetPosition() {
-  px_ = (Board::width - current_piece_->width() - 2) / 2;
-  py_ = 20;
+  px_ = SpawnX(*current_piece());
+  py_ = kSpawnY;
   pd_ = 0;
 }
 
+void PlayerBoard::Hold() {
+  key_ ^= zobrist::Hold(hold_);
+  const uint8_t held = current_piece_;
+  current_piece_ = hold_ == kEmptyHold ? QueuePopId() : hold_;
+  hold_ = held;
+  key_ ^= zobrist::Hold(hold_);
+  ResetPosition();
+}
+
 bool PlayerBoard::Softdrop() {
   bool ok = false;
   while (py_ - 1 >= -10 && IsValidPosition(px_, py_ - 1, pd_)) {
@@ -118,29 +388,22 @@ void PlayerBoard::Harddrop() {
   if (IsValidPosition(px_, py_ + 1, pd_)) mobility |= 3;
 
   spin_ = mobility == 0;
-  current_piece_->Place(board_, px_, py_, pd_);
+  const auto& extent = current_piece()->extent(pd_);
+  int lo = py_ + extent.bottom, hi = py_ + extent.top + 1;
+  for (int i = lo; i < hi; ++i) key_ ^= zobrist::Row(i, board_.grid.row(i));
+  int added = current_piece()->Place(board_, px_, py_, pd_);
+  for (int i = lo; i < hi; ++i) key_ ^= zobrist::Row(i, board_.grid.row(i));
+  board_.UpdateStats(stats_, lo, hi, added);
   // std::cout << board_ << "\n";
   ClearLines();
 
-  spin_ = false;
-  current_piece_ = QueuePop();
+  current_piece_ = QueuePopId();
   ResetPosition();
 }
 
 bool PlayerBoard::RotateCW() {
-  /**
-   * 0->1	( 0, 0)	(-1, 0)	(-1,+1)	( 0,-2)	(-1,-2)
-   * 1->2	( 0, 0)	(+1, 0)	(+1,-1)	( 0,+2)	(+1,+2)
-   * 2->3	( 0, 0)	(+1, 0)	(+1,+1)	( 0,-2)	(+1,-2)
-   * 3->0	( 0, 0)	(-1, 0)	(-1,-1)	( 0,+2)	(-1,+2)
-   */
-  const static std::vector<std::array<int, 2>> offsets = {
-      {0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2},
-  };
-  for (auto [dx, dy] : offsets) {
-    // std::cout << "attempt dxy=" << dx << "," << dy << "\n";
-    if (pd_ == 1 || pd_ == 2) dx *= -1;
-    if (pd_ == 1 || pd_ == 3) dy *= -1;
+  for (auto kick : kKicksCW) {
+    auto [dx, dy] = KickOffset(kick, pd_);
     if (IsValidPosition(px_ + dx, py_ + dy, (pd_ + 1) % 4)) {
       px_ += dx;
       py_ += dy;
@@ -151,19 +414,8 @@ bool PlayerBoard::RotateCW() {
   return false;
 }
 bool PlayerBoard::RotateCCW() {
-  /*
-   * 0->3	( 0, 0)	(+1, 0)	(+1,+1)	( 0,-2)	(+1,-2)
-   * 1->0	( 0, 0)	(+1, 0)	(+1,-1)	( 0,+2)	(+1,+2)
-   * 2->1	( 0, 0)	(-1, 0)	(-1,+1)	( 0,-2)	(-1,-2)
-   * 3->2	( 0, 0)	(-1, 0)	(-1,-1)	( 0,+2)	(-1,+2)
-   */
-  const static std::vector<std::array<int, 2>> offsets = {
-      {0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2},
-  };
-  for (auto [dx, dy] : offsets) {
-    // std::cout << "attempt dxy=" << dx << "," << dy << "\n";
-    if (pd_ == 1 || pd_ == 2) dx *= -1;
-    if (pd_ == 1 || pd_ == 3) dy *= -1;
+  for (auto kick : kKicksCCW) {
+    auto [dx, dy] = KickOffset(kick, pd_);
     if (IsValidPosition(px_ + dx, py_ + dy, (pd_ - 1 + 4) % 4)) {
       px_ += dx;
       py_ += dy;
@@ -197,30 +449,13 @@ bool PlayerBoard::MoveRight() {
 }
 
 int PlayerBoard::ClearLines() {
-  int lines = 0;
-  const static Board::Grid line = pieces::Line10.nesw()[0];
-  int j = 0;
-  for (int i = 0; i < Board::height; ++i) {  // scan from bottom to top
-    auto mask = (line << (Board::width * i));
-    /// TODO: maybe vector<int32_t> would make more sense since you
-    /// have these row-wise operations?
-    auto line_mask = board_.grid & mask;
-    if (line_mask == mask) {
-      ++lines;
-      board_.grid ^= mask;
-    } else {
-      if (i != j) {  // move row i to row j
-        line_mask |= (line_mask >> (Board::width * (i - j)));
-        board_.grid ^= line_mask;
-        // std::cout << "move " << i << " to " << j << "\n";
-        // Board b; b.grid = line_mask; std::cout << b << "\n";
-      }
-      ++j;
-    }
-    // std::cout << mask << "\n";
-    // Board b; b.grid = mask; std::cout << b << "\n";
-    // board_.grid
+  INSTRUMENT_COUNT(kLineClears);
+  int lines = board_.ClearFullRows();
+  if (lines) {
+    stats_ = board_.ComputeStats();
+    key_ = ComputeKey();
   }
+  key_ ^= zobrist::B2b(b2b_) ^ zobrist::Combo(combo_);
   int base = lines;
   if (!spin_ && (base == 1 || base == 2 || base == 3)) base -= 1;
   // std::cout << "cleared " << lines << (spin_ ? "+spin" : "") << "\n";
@@ -238,145 +473,205 @@ int PlayerBoard::ClearLines() {
     combo_ = 0;
   }
   lines_ += lines;
+  key_ ^= zobrist::B2b(b2b_) ^ zobrist::Combo(combo_);
   return lines;
 }
 
+bool PlayerBoard::ReceiveGarbage(int lines) {
+  const int hole = garbage_rng_ % Board::width;
+  garbage_rng_ = hash(garbage_rng_);
+  const Board::Row row = Board::kFullRow & ~(Board::Row(1) << hole);
+  const bool fits = board_.RaiseRows(lines, row);
+  stats_ = board_.ComputeStats();
+  key_ = ComputeKey();
+  return fits;
+}
+
 bool PlayerBoard::IsValidPosition(int x, int y, int d) const {
-  bool ok = !current_piece_->Intersects(board_, x, y, d);
+  INSTRUMENT_COUNT(kCollisionTests);
+  bool ok = !current_piece()->Intersects(board_, x, y, d);
   // std::cout << "testing " << x << " " << y << " " << d << " ";
   // std::cout << (ok ? "OK" : "FAIL");
   // std::cout << "\n";
   return ok;
 }
 
-std::vector<std::array<int, 3>> PlayerBoard::GeneratePlacements() const {
-  PlayerBoard pb(*this);  // make a copy to do the simulations
-  /// TODO: replace with static array with vis counter
-  std::set<std::array<int, 3>> vis, vis_stable;
-  pb.ResetPosition();
-  auto dfs = [&](auto&& dfs) -> void {
-    int px = pb.px();
-    int py = pb.py();
-    int pd = pb.pd();
-    std::array<int, 3> k = {px, py, pd};
-    if (vis.count(k)) return;
-    vis.insert(k);
-
-    if (pb.MoveLeft()) {
-      dfs(dfs);
-      pb.set_px(px);
-      pb.set_py(py);
-      pb.set_pd(pd);
-    }
+std::vector<std::array<int, 3>> PlayerBoard::GeneratePlacements(
+    bool hold) const {
+  // reused by every call on the thread, so the result is allocated only once
+  thread_local std::array<std::array<int, 3>, kMaxPlacements> scratch;
+  int n = GeneratePlacements(scratch, hold);
+  return {scratch.begin(), scratch.begin() + n};
+}
 
-    if (pb.MoveRight()) {
-      dfs(dfs);
-      pb.set_px(px);
-      pb.set_py(py);
-      pb.set_pd(pd);
-    }
+int PlayerBoard::GeneratePlacements(std::span<std::array<int, 3>> out,
+                                    bool hold) const {
+  INSTRUMENT_SCOPE(kGeneratePlacements);
+  // both pieces go on the same grid
+  const uint64_t grid_key = key_ ^ zobrist::QueueIndex(piece_queue_index_) ^
+                            zobrist::Hold(hold_) ^ zobrist::B2b(b2b_) ^
+                            zobrist::Combo(combo_);
+  const int n = PiecePlacements(board_, grid_key, current_piece_, out);
+  if (!hold || n == 0 || hold_ == current_piece_) return n;
+  PlayerBoard held(*this);
+  held.Hold();
+  auto rest = out.subspan(std::min<size_t>(n, out.size()));
+  const int m = PiecePlacements(board_, grid_key, held.current_piece_, rest);
+  for (int i = 0; i < std::min<int>(m, rest.size()); ++i) rest[i][2] += kHold;
+  return n + m;
+}
 
-    if (pb.RotateCW()) {
-      dfs(dfs);
-      pb.set_px(px);
-      pb.set_py(py);
-      pb.set_pd(pd);
-    }
+std::vector<int> PlayerBoard::AttackPotential(int max_depth,
+                                              bool hold) const {
+  // a line of play must keep up with `depth - 2` attack after `depth` pieces;
+  // `slack` is how far ahead of that pace a node is
+  constexpr int kSlack = 2;
+  constexpr int kNoLine = std::numeric_limits<int>::min() / 4;
+  // children are searched in parallel down to this many pieces left, below
+  // it a subtree is too small to pay for the fork
+  constexpr int kSequentialBelow = 2;
+  using Bound = TranspositionTable::Bound;
+  // (state, pieces left, slack) -> most attack the line can still gain
+  TranspositionTable memo(20, TranspositionTable::Replace::kDeeper);
+  auto memo_key = [](const PlayerBoard& pb, int remaining, int slack) {
+    return pb.Key() ^ hash(uint64_t(remaining) << 8 | slack);
+  };
+  // no `remaining` pieces gain more than this: at most 2 attack per cleared
+  // line, combo for every placement that clears, and b2b for every placement
+  // but a first one that starts it (spins that clear nothing keep it going)
+  auto upper_bound = [](const PlayerBoard& pb, int remaining) {
+    int cells = 0;
+    for (auto row : pb.board_.grid.rows()) cells += std::popcount(row);
+    int lines = std::min(4 * remaining,
+                         (cells + 4 * remaining) / Board::width);
+    int clears = std::min(remaining, lines);
+    int b2b = pb.b2b_ > 0 ? remaining : remaining - 1;
+    return 2 * lines + clears * ((pb.combo_ + remaining) / 3) + b2b;
+  };
 
-    if (pb.RotateCCW()) {
-      dfs(dfs);
-      pb.set_px(px);
-      pb.set_py(py);
-      pb.set_pd(pd);
+  // most attack gained by exactly `remaining` more pieces, or at most `alpha`
+  // if it is no more than `alpha`
+  auto search = [&](const PlayerBoard& pb, int remaining, int slack,
+                    int alpha, auto&& search) -> int {
+    if (remaining == 0) return 0;
+    INSTRUMENT_COUNT(kAttackChecks);
+    slack = std::min(slack, remaining);  // the pace can't bind any more
+    if (upper_bound(pb, remaining) <= alpha) return alpha;
+    uint64_t key = memo_key(pb, remaining, slack);
+    TranspositionTable::Entry seen;
+    if (memo.Probe(key, seen) && seen.depth == remaining) {
+      if (seen.bound == Bound::kExact) return seen.eval;
+      if (seen.bound == Bound::kUpper && seen.eval <= alpha) return alpha;
+    }
+    INSTRUMENT_COUNT(kAttackExpands);
+
+    struct Child {
+      PlayerBoard pb;
+      int gain, slack, hint;
+      std::array<int, 3> placement;
+    };
+    std::vector<Child> children;
+    for (auto [x, y, d] : pb.GeneratePlacements(hold)) {
+      Child c{pb, 0, 0, 0, {x, y, d}};
+      c.pb.SimulatePlacement(x, y, d);
+      c.gain = c.pb.attack_ - pb.attack_;
+      c.slack = slack + c.gain - 1;
+      if (c.slack < 0) continue;  // falls behind the pace
+      // the previous pass searched this child with one piece less
+      c.hint = c.gain;
+      if (remaining >= 2 &&
+          memo.Probe(memo_key(c.pb, remaining - 2,
+                              std::min(c.slack, remaining - 2)),
+                     seen) &&
+          seen.depth == remaining - 2 && seen.eval > kNoLine) {
+        c.hint += seen.eval;
+      }
+      children.push_back(c);
+    }
+    std::stable_sort(children.begin(), children.end(),
+                     [](const Child& a, const Child& b) {
+                       return a.hint > b.hint;
+                     });
+
+    std::atomic<int> best = alpha;
+    auto visit = [&](size_t i) {
+      const Child& c = children[i];
+      int need = best.load(std::memory_order_relaxed) - c.gain;
+      int value = search(c.pb, remaining - 1, c.slack, need, search);
+      if (value > need) AtomicMax(best, value + c.gain);
+    };
+    // the most promising child first, so its value prunes its siblings
+    if (!children.empty()) visit(0);
+    if (remaining < kSequentialBelow) {
+      for (size_t i = 1; i < children.size(); ++i) visit(i);
+    } else if (children.size() > 1) {
+      parlay::parallel_for(1, children.size(), visit, 1);
     }
 
-    bool softdrop_worked = pb.Softdrop();
-    vis_stable.insert({pb.px(), pb.py(), pb.pd()});
-    if (softdrop_worked) {
-      dfs(dfs);
-      pb.set_px(px);
-      pb.set_py(py);
-      pb.set_pd(pd);
+    int value = best;
+    TranspositionTable::Entry entry{.eval = float(value),
+                                    .depth = uint8_t(remaining),
+                                    .bound = Bound::kUpper};
+    if (value > alpha) {
+      entry.bound = Bound::kExact;
+      for (const Child& c : children) {
+        // any child reaching the best value will do as the best move
+        if (c.gain > value) continue;
+        auto [x, y, d] = c.placement;
+        entry.x = x, entry.y = y, entry.d = d;
+        break;
+      }
     }
+    memo.Store(key, entry);
+    return value;
   };
-  dfs(dfs);
-
-  std::unordered_set<Board::Grid> ret_vis;
-  std::vector<std::array<int, 3>> ret;
-  Board b;
-  for (auto [x, y, d] : vis_stable) {
-    b.Clear();
-    current_piece_->Place(b, x, y, d);
-    if (ret_vis.count(b.grid)) continue;
-    // std::cout << x << "," << y << "," << d << "\n" << b << "\n";
-    ret_vis.insert(b.grid);
-    ret.push_back({x, y, d});
-  }
-  return ret;
-};
 
-std::vector<int> PlayerBoard::AttackPotential(int max_depth) const {
+  // iterative deepening: every pass reuses the memo of the shallower ones
+  // for move ordering, and its result as an aspiration bound
   std::vector<int> ret(max_depth + 1);
-  std::unordered_set<Board::Grid> vis;
-  vis.reserve(4096);
-  int tot = 0;
-  auto dfs = [&](const PlayerBoard& pb, int depth, auto&& dfs) -> void {
-    if (depth == max_depth + 1) return;
-    ++tot;
-    if (pb.attack() - attack_ + 2 < depth) return;
-    if (pb.attack() + 1 * (max_depth - depth) < ret[depth]) return;
-    // if (pb.attack() >= 4) std::cout << pb << "\n";
-    if (vis.count(pb.board().grid)) return;
-    vis.insert(pb.board().grid);
-    ret[depth] = std::max(ret[depth], pb.attack());
-    for (auto [x, y, d] : pb.GeneratePlacements()) {
-      PlayerBoard pb2 = pb;
-      pb2.set_px(x);
-      pb2.set_py(y);
-      pb2.set_pd(d);
-      pb2.Harddrop();
-      dfs(pb2, depth + 1, dfs);
-    }
-  };
-  dfs(*this, 0, dfs);
-  for (auto& x : ret) x -= attack_;
-  std::cout << "check " << tot << ", expand " << vis.size() << ", pruned "
-            << (tot - vis.size()) << "\n";
+  for (int depth = 1; depth <= max_depth; ++depth) {
+    int alpha = ret[depth - 1] - 1;
+    int best = search(*this, depth, kSlack, alpha, search);
+    if (best <= alpha) best = search(*this, depth, kSlack, kNoLine, search);
+    ret[depth] = std::max(best, 0);
+  }
+  INSTRUMENT_ADD(kMemoHits, memo.stats().hits);
+  INSTRUMENT_ADD(kMemoMisses, memo.stats().misses + memo.stats().collisions);
   return ret;
 };
 
 void PlayerBoard::SimulatePlacement(int x, int y, int d) {
+  if (d >= kHold) {
+    Hold();
+    d -= kHold;
+  }
   set_px(x);
   set_py(y);
   set_pd(d);
   Harddrop();
 }
 
-double PlayerBoard::Evaluate() const {
-  int lbonus = 5 * (attack_ + 2 * std::min(2, b2b_)) + lines_;
-  lbonus += (combo_ >= 4 ? combo_ * combo_ * 5 : 0);
-  int flatness = 0;
-  int holes = 0;
-  int prev = -2;
-  for (int j = 0; j < Board::width; ++j) {
-    int hi = -1;
-    for (int i = Board::height - 1; i >= 0; --i) {
-      if (board_.grid[i * Board::width + j]) {
-        if (hi == -1) hi = i;
-      } else {
-        if (hi != -1) ++holes;
-      }
-    }
-    if (j) {
-      flatness -= std::abs(hi - prev);
-    }
-    prev = hi;
-  }
-  return lbonus + 2*flatness + (-25)*holes;
+double PlayerBoard::Evaluate(const EvalWeights& weights) const {
+#ifdef VERIFY_BOARD_STATS
+  assert(stats_ == board_.ComputeStats() && "cached stats out of sync");
+  assert(key_ == ComputeKey() && "cached key out of sync");
+#endif
+  return Evaluate(stats_.holes, stats_.bumpiness, weights);
+}
+
+double PlayerBoard::Evaluate(int holes, int bumpiness,
+                             const EvalWeights& weights) const {
+  INSTRUMENT_COUNT(kEvaluations);
+  double lbonus = weights.attack * attack_ +
+                  weights.b2b * std::min<int>(2, b2b_) + weights.lines * lines_;
+  lbonus += (combo_ >= 4 ? weights.combo * combo_ * combo_ : 0);
+  return lbonus + weights.bumpiness * bumpiness + weights.holes * holes;
 }
 
 std::ostream& operator<<(std::ostream& out, const PlayerBoard& rhs) {
-  out << " curr: " << rhs.current_piece_->name() << "\n";
+  out << " curr: " << rhs.current_piece()->name() << "\n";
+  out << " hold: " << (rhs.hold_piece() ? rhs.hold_piece()->name() : "-")
+      << "\n";
   out << " sent: " << rhs.attack_ << "\n";
   out << "  b2b: " << rhs.b2b_ << "\n";
   out << "combo: " << rhs.combo_ << "\n";
@@ -2,18 +2,44 @@
 #define SRC_GAME_BOARD_HH_
 
 #include <array>
+#include <cstdint>
+#include <span>
+#include <type_traits>
 
 #include "board.hh"
 #include "pieces.hh"
 
 /**
- * Represents a game state for one player
+ * Weights of the terms of `PlayerBoard::Evaluate()`. The defaults are the
+ * original hand picked ones, other values come from tuning.
+ */
+struct EvalWeights {
+  double attack = 5;      // per line sent
+  double b2b = 10;        // per level of back to back, counting up to 2
+  double lines = 1;       // per line cleared
+  double combo = 5;       // times the combo squared, from a combo of 4 on
+  double bumpiness = -2;  // per height step between adjacent columns
+  double holes = -25;     // per empty cell under the top of its column
+
+  constexpr static int kSize = 6;
+  // the weights in declaration order, for tuning
+  constexpr std::array<double, kSize> ToArray() const {
+    return {attack, b2b, lines, combo, bumpiness, holes};
+  }
+  constexpr static EvalWeights FromArray(const std::array<double, kSize>& a) {
+    return {a[0], a[1], a[2], a[3], a[4], a[5]};
+  }
+  bool operator==(const EvalWeights&) const = default;
+};
+
+/**
+ * Represents a game state for one player. Trivially copyable and packed so
+ * search nodes can be memcpy'd into flat arrays and hashed as bytes.
  */
 class PlayerBoard {
  public:
   PlayerBoard();
   PlayerBoard(uint64_t seed);
-  PlayerBoard(const PlayerBoard&);
 
   /**
    * @brief loads the string onto the board, useful for testing
@@ -28,9 +54,24 @@ class PlayerBoard {
   void set_pd(int pd) { pd_ = pd; }
   bool spin() const { return spin_; }
   int attack() const { return attack_; }
+  int lines() const { return lines_; }
   const auto& board() const { return board_; }
-  const Piece* current_piece() const { return current_piece_; }
-  void set_current_piece(const Piece* piece) { current_piece_ = piece; }
+  const Board::Stats& stats() const { return stats_; }
+  const Piece* current_piece() const { return pieces::kAll7[current_piece_]; }
+  void set_current_piece(const Piece* piece);
+  // `nullptr` while the hold is empty
+  const Piece* hold_piece() const {
+    return hold_ == kEmptyHold ? nullptr : pieces::kAll7[hold_];
+  }
+  // `nullptr` empties the hold, used in testing
+  void set_hold_piece(const Piece* piece);
+
+  /**
+   * @brief Zobrist hash of everything that decides how the game continues:
+   * the board, queue position, hold piece, b2b and combo. Kept up to date
+   * incrementally, used to key transposition tables.
+   */
+  uint64_t Key() const { return key_; }
 
   /**
    * @brief Set the Queue object, used in testing.
@@ -51,6 +92,12 @@ class PlayerBoard {
    */
   void ResetPosition();
 
+  /**
+   * @brief Swaps the current piece with the hold piece, or with the next
+   * piece of the queue if the hold is empty, and resets the position.
+   */
+  void Hold();
+
   void Harddrop();
   // returns true when successful
   bool Softdrop();
@@ -82,24 +129,57 @@ class PlayerBoard {
    */
   bool IsValidPosition(int x, int y, int d) const;
 
+  // added to `d` of a placement that holds first, so the placement is of the
+  // piece `Hold()` brings in
+  constexpr static int kHold = 4;
+
+  // no placement list is longer: each orientation of the current piece and
+  // of the one held in lands at most once per cell
+  constexpr static int kMaxPlacements = 2 * 4 * Board::width * Board::height;
+
   /**
    * @brief Generates all possible placements for `current_piece_`.
    *
+   * With `hold`, they are followed by the placements of the piece `Hold()`
+   * brings in, with `kHold` added to their `d`, unless that is the current
+   * piece again. Both are empty if the current piece does not fit at spawn.
+   *
+   * The placements of a piece only depend on the grid, so every thread keeps
+   * the recent ones per (grid, piece) and shares them between the two pieces
+   * and between states on the same grid, e.g. siblings that differ in hold.
+   *
    * @return `std::vector<std::array<int, 3>>` tuple of <x,y,d>
    */
-  std::vector<std::array<int, 3>> GeneratePlacements() const;
+  std::vector<std::array<int, 3>> GeneratePlacements(bool hold = false) const;
+
+  /**
+   * @brief `GeneratePlacements()` without heap allocation, for hot loops.
+   *
+   * Writes the first `out.size()` placements, in the same order, to `out`.
+   *
+   * @return the number of placements, which can be more than `out.size()`
+   */
+  int GeneratePlacements(std::span<std::array<int, 3>> out,
+                         bool hold = false) const;
 
   /**
    * @brief Generate maximum attack damage after placing `max_depth` pieces
    *
+   * Only lines of play with at least `i - 2` attack after every `i` pieces
+   * are considered. Within those the result is exact: the search deepens one
+   * piece at a time, memoizes bounds per (state, pieces left) and searches
+   * subtrees in parallel.
+   *
    * @param max_depth
+   * @param hold whether lines of play may hold, see `GeneratePlacements()`
    * @return `std::vector<int>` where the `i`th value has the maximum attack
    * when you are allowed to place exactly `i` pieces.
    */
-  std::vector<int> AttackPotential(int max_depth) const;
+  std::vector<int> AttackPotential(int max_depth, bool hold = false) const;
 
   /**
-   * @brief shorthand for moving current piece to x,y,d and then harddrop
+   * @brief shorthand for moving current piece to x,y,d and then harddrop,
+   * holding first if `d >= kHold`
    *
    * @param x
    * @param y
@@ -108,44 +188,89 @@ class PlayerBoard {
   void SimulatePlacement(int x, int y, int d);
 
   /**
-   * @brief runs some heuristics based on misamino
+   * @brief Pushes `lines` rows of garbage in from the bottom, all with their
+   * hole in one column drawn from the garbage rng.
+   *
+   * @return `false` if the board overflowed, which tops the player out
+   */
+  bool ReceiveGarbage(int lines);
+
+  /**
+   * @brief runs some heuristics based on misamino, O(1) using the cached
+   * `stats()`. Define `VERIFY_BOARD_STATS` to check the cached stats and key
+   * against a full rescan on every call.
    *
    * @return double
    */
-  double Evaluate() const;
+  double Evaluate(const EvalWeights& weights = {}) const;
+
+  /**
+   * @brief `Evaluate()` with board features supplied by the caller, e.g. by
+   * `batch_eval::Evaluate`.
+   */
+  double Evaluate(int holes, int bumpiness,
+                  const EvalWeights& weights = {}) const;
 
   friend std::ostream& operator<<(std::ostream& out, const PlayerBoard& rhs);
+  // the whole state, including the rngs and the current piece's position
+  bool operator==(const PlayerBoard&) const = default;
 
  private:
+  // zobrist key, see `Key()`
+  uint64_t key_;
+  // circular queue of 14 piece ids (index into `pieces::kAll7`), 3 bits each,
+  // indexed by `piece_queue_index_`
+  uint64_t piece_queue_;
+  // rng state
+  uint64_t queue_rng_, garbage_rng_;
+  int32_t attack_ = 0;  // lines sent (pending attack)
+  int32_t lines_ = 0;   // lines cleared
+
   Board board_;
+  // kept in sync with `board_` on every placement and line clear
+  Board::Stats stats_;
 
-  // used to allow overriding the current piece in testing
-  const Piece* current_piece_;
+  uint16_t b2b_ = 0;    // length of back to back
+  uint16_t combo_ = 0;  // length of ongoing combo
   // piece offsets
-  int px_, py_;
+  int8_t px_, py_;
   // piece orientation direction
-  int pd_;
+  int8_t pd_;
+  // id of the current piece, can be overridden in testing
+  uint8_t current_piece_;
+  // indexes into piece_queue
+  uint8_t piece_queue_index_;
+  // offset of the current set of 7 in `piece_queue_`, the other 7 are next
+  uint8_t queue_curr_;
   // whether spin bonus is active, determined at harddrop time, before line
   // updates (double attack)
   bool spin_;
-  int b2b_ = 0;     // length of back to back
-  int combo_ = 0;   // length of ongoing combo
-  int attack_ = 0;  // lines sent (pending attack)
-  int lines_ = 0;   // lines cleared
-
-  // circular queue indexed by `piece_queue_index`
-  const Piece* piece_queue_[14];
-  const Piece** queue_curr_;  // current set of 7
-  const Piece** queue_next_;  // next set of 7
-  // indexes into piece_queue
-  uint8_t piece_queue_index_;
-  // rng state
-  uint64_t queue_rng_, garbage_rng_;
+  // id of the held piece, `kEmptyHold` if none
+  uint8_t hold_;
+
+  constexpr static uint8_t kEmptyHold = 7;
+
+  int queue_at(int i) const { return (piece_queue_ >> (3 * i)) & 7; }
+  void set_queue_at(int i, int id) {
+    piece_queue_ &= ~(uint64_t(7) << (3 * i));
+    piece_queue_ |= uint64_t(id) << (3 * i);
+  }
+
+  // `QueuePop` returning the id of the piece
+  int QueuePopId();
 
   /**
    * Determines the next 7 unknown pieces of the queue.
    */
   void RefreshQueue();
+
+  /**
+   * Recomputes `key_` from scratch.
+   */
+  uint64_t ComputeKey() const;
 };
 
+static_assert(std::is_trivially_copyable_v<PlayerBoard>);
+static_assert(sizeof(PlayerBoard) <= 128, "search nodes fit in two cache lines");
+
 #endif  // SRC_GAME_BOARD_HH_
\ No newline at end of file
@@ -2,7 +2,128 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <bit>
+#include <cstdlib>
 #include <iostream>
+#include <new>
+#include <set>
+#include <unordered_set>
+
+#include "hash.h"
+
+namespace {
+
+// heap allocations made by the test binary so far
+std::atomic<size_t> allocations{0};
+
+}  // namespace
+
+// kept out of line so the compiler does not pair up calls it can see into
+[[gnu::noinline]] void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+[[gnu::noinline]] void* operator new[](size_t size) {
+  return operator new(size);
+}
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+[[gnu::noinline]] void operator delete[](void* p, size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+// Straightforward search over single moves, used to check the bitboard
+// placement generator.
+std::vector<std::array<int, 3>> ReferencePlacements(const PlayerBoard& board) {
+  PlayerBoard pb(board);
+  std::set<std::array<int, 3>> vis, vis_stable;
+  pb.ResetPosition();
+  if (!pb.IsValidPosition(pb.px(), pb.py(), pb.pd())) return {};
+  auto dfs = [&](auto&& dfs) -> void {
+    int px = pb.px(), py = pb.py(), pd = pb.pd();
+    if (!vis.insert({px, py, pd}).second) return;
+    auto restore = [&]() {
+      pb.set_px(px);
+      pb.set_py(py);
+      pb.set_pd(pd);
+    };
+    if (pb.MoveLeft()) dfs(dfs), restore();
+    if (pb.MoveRight()) dfs(dfs), restore();
+    if (pb.RotateCW()) dfs(dfs), restore();
+    if (pb.RotateCCW()) dfs(dfs), restore();
+    bool softdrop_worked = pb.Softdrop();
+    vis_stable.insert({pb.px(), pb.py(), pb.pd()});
+    if (softdrop_worked) dfs(dfs), restore();
+  };
+  dfs(dfs);
+
+  std::unordered_set<Board::Grid> ret_vis;
+  std::vector<std::array<int, 3>> ret;
+  Board b;
+  for (auto [x, y, d] : vis_stable) {
+    b.Clear();
+    pb.current_piece()->Place(b, x, y, d);
+    if (!ret_vis.insert(b.grid).second) continue;
+    ret.push_back({x, y, d});
+  }
+  return ret;
+}
+
+// deterministic messy board with `rows` rows, none of them full
+std::string RandomBoard(uint64_t seed, int rows) {
+  std::string s;
+  for (int i = 0; i < rows; ++i) {
+    std::string row;
+    for (int j = 0; j < Board::width; ++j) {
+      seed = hash(seed);
+      row += seed % 100 < 60 ? '#' : '.';
+    }
+    if (row == std::string(Board::width, '#')) row[seed % Board::width] = '.';
+    s += row + "\n";
+  }
+  return s;
+}
+
+// the board in the format `LoadBoard` reads
+std::string BoardString(const Board& board) {
+  std::string s;
+  for (int i = Board::height - 1; i >= 0; --i) {
+    for (int j = 0; j < Board::width; ++j) {
+      s += board.grid[i * Board::width + j] ? '#' : '.';
+    }
+    s += "\n";
+  }
+  return s;
+}
+
+// most attack after exactly `i` pieces, by trying every line of play that
+// keeps up with `depth - 2` attack after `depth` pieces
+std::vector<int> ReferenceAttackPotential(const PlayerBoard& root,
+                                          int max_depth, bool hold = false) {
+  std::vector<int> ret(max_depth + 1);
+  auto dfs = [&](const PlayerBoard& pb, int depth, auto&& dfs) -> void {
+    int gain = pb.attack() - root.attack();
+    if (gain + 2 < depth) return;
+    ret[depth] = std::max(ret[depth], gain);
+    if (depth == max_depth) return;
+    for (auto [x, y, d] : pb.GeneratePlacements(hold)) {
+      PlayerBoard child(pb);
+      child.SimulatePlacement(x, y, d);
+      dfs(child, depth + 1, dfs);
+    }
+  };
+  dfs(root, 0, dfs);
+  return ret;
+}
+
+}  // namespace
 
 TEST(PlayerBoard, CopyConstructor) {
   PlayerBoard pb;
@@ -225,6 +346,90 @@ TEST(PlayerBoard, GeneratePlacements_TST) {
   EXPECT_TRUE(ok) << "Should have found one valid TST kick.";
 }
 
+TEST(PlayerBoard, GeneratePlacements_MatchesReference) {
+  for (int t = 0; t < 200; ++t) {
+    PlayerBoard pb;
+    if (t % 12) pb.LoadBoard(RandomBoard(t, t % 12));
+    for (auto piece : pieces::kAll7) {
+      pb.set_current_piece(piece);
+      ASSERT_EQ(pb.GeneratePlacements(), ReferencePlacements(pb))
+          << "board " << t << ", piece " << piece->name() << "\n"
+          << pb;
+    }
+  }
+}
+
+TEST(PlayerBoard, GeneratePlacements_NoAllocation) {
+  PlayerBoard pb;
+  pb.LoadBoard(RandomBoard(3, 8));
+  auto expected = pb.GeneratePlacements();
+  std::array<std::array<int, 3>, PlayerBoard::kMaxPlacements> buffer;
+  std::array<std::array<int, 3>, 3> prefix;
+
+  size_t before = allocations;
+  int n = pb.GeneratePlacements(buffer);
+  int total = pb.GeneratePlacements(prefix);
+  size_t allocated = allocations - before;
+  EXPECT_EQ(allocated, 0);
+  ASSERT_EQ(n, expected.size());
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(), buffer.begin()));
+  EXPECT_EQ(total, n) << "a short buffer still gets the total";
+  EXPECT_TRUE(std::equal(prefix.begin(), prefix.end(), expected.begin()));
+
+  before = allocations;
+  auto again = pb.GeneratePlacements();
+  allocated = allocations - before;
+  EXPECT_EQ(allocated, 1) << "only the returned vector";
+  EXPECT_EQ(again, expected);
+}
+
+TEST(PlayerBoard, GeneratePlacements_Hold) {
+  for (int t = 0; t < 100; ++t) {
+    PlayerBoard pb(t);
+    if (t % 12) pb.LoadBoard(RandomBoard(t, t % 12));
+    pb.set_current_piece(pieces::kAll7[t % 7]);
+    if (t % 3) pb.set_hold_piece(pieces::kAll7[t / 3 % 7]);
+    PlayerBoard held(pb);
+    held.Hold();
+    const auto current = ReferencePlacements(pb);
+    auto expected = current;
+    if (!current.empty() && pb.hold_piece() != pb.current_piece()) {
+      for (auto [x, y, d] : ReferencePlacements(held)) {
+        expected.push_back({x, y, d + PlayerBoard::kHold});
+      }
+    }
+    ASSERT_EQ(pb.GeneratePlacements(true), expected) << "board " << t << "\n"
+                                                     << pb;
+    // the current piece again, now from the cache
+    ASSERT_EQ(pb.GeneratePlacements(), current) << "board " << t;
+    if (expected.size() == current.size()) continue;
+    auto [x, y, d] = expected.back();
+    PlayerBoard placed(pb);
+    placed.SimulatePlacement(x, y, d);
+    held.SimulatePlacement(x, y, d - PlayerBoard::kHold);
+    EXPECT_EQ(placed, held) << "holds, then places the held in piece";
+  }
+}
+
+TEST(PlayerBoard, Hold) {
+  PlayerBoard pb;
+  pb.SetQueue({&pieces::T, &pieces::I, &pieces::O});
+  EXPECT_EQ(pb.hold_piece(), nullptr);
+  pb.Hold();
+  EXPECT_EQ(pb.current_piece(), &pieces::I) << "the hold was empty";
+  EXPECT_EQ(pb.hold_piece(), &pieces::T);
+  pb.Hold();
+  EXPECT_EQ(pb.current_piece(), &pieces::T) << "swapped back";
+  EXPECT_EQ(pb.hold_piece(), &pieces::I);
+  PlayerBoard rehashed(pb);
+  rehashed.LoadBoard("");  // key from scratch
+  EXPECT_EQ(pb.Key(), rehashed.Key());
+  rehashed.set_hold_piece(&pieces::O);
+  EXPECT_NE(pb.Key(), rehashed.Key()) << "the hold piece is part of the key";
+  rehashed.set_hold_piece(&pieces::I);
+  EXPECT_EQ(pb.Key(), rehashed.Key());
+}
+
 TEST(PlayerBoard, ClearLines) {
   PlayerBoard pb;
   pb.LoadBoard(
@@ -235,6 +440,152 @@ TEST(PlayerBoard, ClearLines) {
   EXPECT_EQ(pb.board().grid[0], 1) << "that one block should've dropped";
 }
 
+TEST(PlayerBoard, ReceiveGarbage) {
+  PlayerBoard pb(3);
+  pb.LoadBoard("#.........");
+  EXPECT_TRUE(pb.ReceiveGarbage(2));
+  const Board::Row garbage = pb.board().grid.row(0);
+  EXPECT_EQ(std::popcount(garbage), Board::width - 1) << "one hole";
+  EXPECT_EQ(pb.board().grid.row(1), garbage) << "same column per attack";
+  EXPECT_EQ(pb.board().grid.row(2), 0b1) << "the stack moves up";
+  EXPECT_EQ(pb.stats(), pb.board().ComputeStats());
+  PlayerBoard rehashed(pb);
+  rehashed.LoadBoard(BoardString(pb.board()));
+  EXPECT_EQ(pb.Key(), rehashed.Key());
+  EXPECT_FALSE(pb.ReceiveGarbage(Board::height - 2)) << "pushed off the top";
+}
+
+TEST(PlayerBoard, CachedStats) {
+  PlayerBoard pb(1);
+  pb.LoadBoard(
+      "#.#.....##\n"
+      "####.#####");
+  EXPECT_EQ(pb.stats(), pb.board().ComputeStats()) << "loaded board";
+  for (int i = 0; i < 200; ++i) {
+    auto placements = pb.GeneratePlacements();
+    if (placements.empty()) break;
+    // pick the lowest placement so the stack keeps clearing lines
+    auto [x, y, d] = *std::min_element(
+        placements.begin(), placements.end(),
+        [](const auto& a, const auto& b) { return a[1] < b[1]; });
+    pb.SimulatePlacement(x, y, d);
+    ASSERT_EQ(pb.stats(), pb.board().ComputeStats()) << "after move " << i;
+  }
+}
+
+TEST(PlayerBoard, EvaluateWeights) {
+  PlayerBoard pb(4);
+  pb.LoadBoard(
+      "#.#.....##\n"
+      "####.#####");
+  for (int i = 0; i < 20; ++i) {
+    auto [x, y, d] = pb.GeneratePlacements().front();
+    pb.SimulatePlacement(x, y, d);
+  }
+  EXPECT_EQ(pb.Evaluate(EvalWeights()), pb.Evaluate()) << "the defaults";
+  auto doubled = EvalWeights().ToArray();
+  for (double& w : doubled) w *= 2;
+  EXPECT_EQ(pb.Evaluate(EvalWeights::FromArray(doubled)), 2 * pb.Evaluate());
+  EXPECT_EQ(pb.Evaluate({.holes = -1}), pb.Evaluate({.holes = 0}) -
+                                            pb.stats().holes)
+      << "linear in each weight";
+  EXPECT_EQ(EvalWeights::FromArray(EvalWeights().ToArray()), EvalWeights());
+}
+
+TEST(PlayerBoard, KeyTransposition) {
+  PlayerBoard a, b;
+  a.SetQueue({&pieces::O, &pieces::O, &pieces::O});
+  b.SetQueue({&pieces::O, &pieces::O, &pieces::O});
+  EXPECT_EQ(a.Key(), b.Key());
+  a.SimulatePlacement(0, 0, 0);
+  b.SimulatePlacement(4, 0, 0);
+  EXPECT_NE(a.Key(), b.Key()) << "different boards";
+  a.SimulatePlacement(4, 0, 0);
+  b.SimulatePlacement(0, 0, 0);
+  EXPECT_EQ(a.Key(), b.Key()) << "same state, different move order";
+}
+
+TEST(PlayerBoard, KeyIncremental) {
+  PlayerBoard pb(2);
+  pb.LoadBoard(
+      "##.....###\n"
+      "####.#####");
+  for (int i = 0; i < 200; ++i) {
+    auto placements = pb.GeneratePlacements();
+    if (placements.empty()) break;
+    auto [x, y, d] = *std::min_element(
+        placements.begin(), placements.end(),
+        [](const auto& a, const auto& b) { return a[1] < b[1]; });
+    pb.SimulatePlacement(x, y, d);
+    PlayerBoard rehashed(pb);
+    rehashed.LoadBoard(BoardString(pb.board()));  // key from scratch
+    ASSERT_EQ(pb.Key(), rehashed.Key()) << "after move " << i;
+  }
+}
+
+TEST(PlayerBoard, AttackPotential_MatchesReference) {
+  PlayerBoard pb;
+  pb.SetQueue({&pieces::J, &pieces::T, &pieces::T, &pieces::I});
+  for (uint64_t seed = 0; seed < 4; ++seed) {
+    pb.LoadBoard(RandomBoard(seed, 6) +
+                 "######.###\n"
+                 "#####...##\n"
+                 "######.###");
+    EXPECT_EQ(pb.AttackPotential(3), ReferenceAttackPotential(pb, 3))
+        << "seed " << seed;
+  }
+
+  // with b2b going, spins that clear nothing still attack
+  pb.SetQueue({&pieces::I, &pieces::J, &pieces::T, &pieces::T, &pieces::I});
+  pb.LoadBoard(
+      "#########.\n"
+      "#########.\n"
+      "#########.\n"
+      "#########.");
+  for (auto [x, y, d] : pb.GeneratePlacements()) {
+    PlayerBoard quad(pb);
+    quad.SimulatePlacement(x, y, d);
+    if (quad.attack() == 4) pb = quad;
+  }
+  ASSERT_EQ(pb.attack(), 4) << "a quad starts b2b";
+  pb.LoadBoard(
+      "...#...#..\n"
+      "...#.#....\n"
+      ".....#....");
+  EXPECT_EQ(pb.AttackPotential(3), ReferenceAttackPotential(pb, 3))
+      << "b2b, sparse";
+  for (uint64_t seed = 0; seed < 4; ++seed) {
+    pb.LoadBoard(RandomBoard(seed, 6) +
+                 "######.###\n"
+                 "#####...##\n"
+                 "######.###");
+    EXPECT_EQ(pb.AttackPotential(3), ReferenceAttackPotential(pb, 3))
+        << "b2b, seed " << seed;
+  }
+}
+
+TEST(PlayerBoard, AttackPotential_Hold) {
+  PlayerBoard pb;
+  pb.SetQueue({&pieces::O, &pieces::I, &pieces::T, &pieces::S});
+  pb.LoadBoard(
+      "#########.\n"
+      "#########.\n"
+      "#########.\n"
+      "#########.");
+  EXPECT_EQ(pb.AttackPotential(1), (std::vector<int>{0, 0}));
+  EXPECT_EQ(pb.AttackPotential(1, true), (std::vector<int>{0, 4}))
+      << "hold the O for the I";
+  for (uint64_t seed = 0; seed < 2; ++seed) {
+    pb.LoadBoard(RandomBoard(seed, 6) +
+                 "######.###\n"
+                 "#####...##\n"
+                 "######.###");
+    EXPECT_EQ(pb.AttackPotential(3, true),
+              ReferenceAttackPotential(pb, 3, true))
+        << "seed " << seed;
+  }
+}
+
 TEST(PlayerBoard, ClearQuad) {
   PlayerBoard pb;
   pb.SetQueue({&pieces::I, &pieces::I, &pieces::I});
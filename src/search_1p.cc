@@ -1,17 +1,291 @@
 /**
  * game tree search for 1 player
+ *
+ * With `--bench` it instead plays a fixed corpus of start positions for every
+ * thread count and beam width (or playout count with `--engine=mcts`) and
+ * prints the throughput and the attack sent as JSON, see `BenchOptions` for
+ * the flags. With `--hold` the searches also branch on the hold piece.
  */
 
 #include <parlay/parallel.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
-#include <tuple>
-#include <utility>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "beam_search.hh"
+#include "engine.hh"
+#include "hash.h"
+#include "instrument.hh"
+#include "mcts.hh"
 #include "player_board.hh"
 
-int32_t main() {
+extern char** environ;  // for the environment of child processes
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+  int moves = 20;            // --moves: moves played from each start position
+  int positions = 4;         // --positions: start positions in the corpus
+  std::vector<int> threads;  // --threads=1,2: default 1, 2, 4, ... all cores
+  std::vector<int> beams = {100, 1000};  // --beams: beam widths to sweep
+  int depth = 10;                        // --depth
+  int cap = 100;                         // --cap: branching cap
+  int budget_ms = 0;  // --budget: time budget per move, 0 for none
+  bool reuse = true;  // --no-reuse: search every move from scratch
+  bool mcts = false;  // --engine=mcts (or beam, the default)
+  bool hold = false;  // --hold: search with the hold piece
+  // --iterations: playouts per move to sweep with mcts
+  std::vector<int> iterations = {1000, 10000};
+
+  // the beam widths or playout counts to sweep
+  const std::vector<int>& sizes() const { return mcts ? iterations : beams; }
+};
+
+// the numbers one run of a setting reports back
+struct BenchRun {
+  int threads, size;  // beam width or playouts per move
+  int moves = 0;
+  size_t nodes = 0;
+  int depth = 0;   // summed over moves
+  int attack = 0;  // lines sent, summed over start positions
+  double seconds = 0, p50_ms = 0, p99_ms = 0;
+  long peak_rss_kb = 0;
+};
+
+// parses `s` as a whole integer of at least `min` into `out`, false if it
+// is anything else
+bool ParseInt(const std::string& s, int& out, int min = 1) {
+  try {
+    size_t used;
+    const int value = std::stoi(s, &used);
+    if (used != s.size() || value < min) return false;
+    out = value;
+    return true;
+  } catch (const std::logic_error&) {  // not a number, or out of range
+    return false;
+  }
+}
+
+// a comma separated list of `ParseInt` values, false if any is bad
+bool ParseList(const char* s, std::vector<int>& out) {
+  std::vector<int> list;
+  std::istringstream in(s);
+  for (std::string item; std::getline(in, item, ',');) {
+    if (!ParseInt(item, list.emplace_back())) return false;
+  }
+  if (list.empty()) return false;
+  out = list;
+  return true;
+}
+
+// start position `i` of the corpus: a seeded queue on up to 6 rows of
+// garbage with one gap per row
+PlayerBoard StartPosition(int i) {
+  uint64_t seed = hash(i + 1);
+  PlayerBoard pb(seed);
+  std::string s;
+  for (int rows = seed % 7; rows > 0; --rows) {
+    seed = hash(seed);
+    std::string row(Board::width, '#');
+    row[seed % Board::width] = '.';
+    s += row + "\n";
+  }
+  pb.LoadBoard(s);
+  return pb;
+}
+
+// nearest rank percentile of sorted `v`
+double Percentile(const std::vector<double>& v, double q) {
+  if (v.empty()) return 0;
+  size_t rank = std::ceil(q * v.size());
+  return v[std::max<size_t>(rank, 1) - 1];
+}
+
+// plays the corpus with the threads parlay was started with, `Search` is
+// `BeamSearch` or `Mcts`
+template <typename Search>
+BenchRun RunSetting(const BenchOptions& options, Search& search, int size) {
+  BenchRun run{.threads = int(parlay::num_workers()), .size = size};
+  std::vector<double> latencies_ms;
+  for (int i = 0; i < options.positions; ++i) {
+    PlayerBoard pb = StartPosition(i);
+    for (int m = 0; m < options.moves; ++m) {
+      if (pb.GeneratePlacements().empty()) break;  // topped out
+      auto start = Clock::now();
+      auto result = search.Search(pb);
+      std::chrono::duration<double> elapsed = Clock::now() - start;
+      run.seconds += elapsed.count();
+      latencies_ms.push_back(1e3 * elapsed.count());
+      run.nodes += result.stats.nodes;
+      run.depth += result.stats.depth;
+      ++run.moves;
+      auto [x, y, d] = result.placement;
+      pb.SimulatePlacement(x, y, d);
+    }
+    run.attack += pb.attack();
+  }
+  std::sort(latencies_ms.begin(), latencies_ms.end());
+  run.p50_ms = Percentile(latencies_ms, 0.50);
+  run.p99_ms = Percentile(latencies_ms, 0.99);
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  run.peak_rss_kb = usage.ru_maxrss;  // kilobytes on Linux
+  return run;
+}
+
+// the flags that make a child process run `options`
+std::vector<std::string> Flags(const BenchOptions& options) {
+  std::vector<std::string> flags = {
+      "--moves=" + std::to_string(options.moves),
+      "--positions=" + std::to_string(options.positions),
+      "--depth=" + std::to_string(options.depth),
+      "--cap=" + std::to_string(options.cap),
+      "--budget=" + std::to_string(options.budget_ms)};
+  if (!options.reuse) flags.push_back("--no-reuse");
+  if (options.mcts) flags.push_back("--engine=mcts");
+  if (options.hold) flags.push_back("--hold");
+  return flags;
+}
+
+// runs one setting in a fresh process, since parlay fixes its thread count
+// at startup and peak RSS is only tracked per process. The child is spawned
+// directly, not through a shell, with `PARLAY_NUM_THREADS` set in its
+// environment.
+bool RunChild(const char* self, const BenchOptions& options, int threads,
+              int size, BenchRun& run) {
+  std::vector<std::string> args = {
+      self, "--bench-run",
+      (options.mcts ? "--iterations=" : "--beams=") + std::to_string(size)};
+  for (auto& flag : Flags(options)) args.push_back(flag);
+  std::vector<char*> argv;
+  for (auto& arg : args) argv.push_back(arg.data());
+  argv.push_back(nullptr);
+
+  std::string threads_var = "PARLAY_NUM_THREADS=" + std::to_string(threads);
+  std::vector<char*> envp;
+  for (char** var = environ; *var; ++var) {
+    if (std::strncmp(*var, "PARLAY_NUM_THREADS=", 19) != 0) {
+      envp.push_back(*var);
+    }
+  }
+  envp.push_back(threads_var.data());
+  envp.push_back(nullptr);
+
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0) return false;
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addclose(&actions, pipe_fds[0]);
+  posix_spawn_file_actions_addclose(&actions, pipe_fds[1]);
+  pid_t pid;
+  const int error = posix_spawnp(&pid, self, &actions, nullptr, argv.data(),
+                                 envp.data());
+  posix_spawn_file_actions_destroy(&actions);
+  close(pipe_fds[1]);
+  if (error != 0) {
+    close(pipe_fds[0]);
+    return false;
+  }
+  std::string out;
+  char buf[256];
+  for (ssize_t n; (n = read(pipe_fds[0], buf, sizeof(buf))) != 0;) {
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) break;
+    out.append(buf, n);
+  }
+  close(pipe_fds[0]);
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) return false;
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+  std::istringstream in(out);
+  run.size = size;
+  return bool(in >> run.threads >> run.moves >> run.nodes >> run.depth >>
+              run.attack >> run.seconds >> run.p50_ms >> run.p99_ms >>
+              run.peak_rss_kb);
+}
+
+int Bench(const char* self, BenchOptions options) {
+  const int cores = std::max(1u, std::thread::hardware_concurrency());
+  if (options.threads.empty()) {
+    for (int t = 1; t < cores; t *= 2) options.threads.push_back(t);
+    options.threads.push_back(cores);
+  }
+
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "{\"engine\": \"" << (options.mcts ? "mcts" : "beam")
+            << "\", \"cores\": " << cores << ", \"positions\": "
+            << options.positions << ", \"moves\": " << options.moves
+            << ", \"depth\": " << options.depth
+            << ", \"branching_cap\": " << options.cap
+            << ", \"budget_ms\": " << options.budget_ms
+            << ", \"reuse\": " << (options.reuse ? "true" : "false")
+            << ", \"hold\": " << (options.hold ? "true" : "false")
+            << ", \"runs\": [";
+  bool first = true;
+  for (int size : options.sizes()) {
+    double base_rate = 0;  // nodes/sec with one thread
+    for (int threads : options.threads) {
+      BenchRun run;
+      if (!RunChild(self, options, threads, size, run)) {
+        std::cerr << "run with " << threads << " threads and size " << size
+                  << " failed\n";
+        return 1;
+      }
+      const double rate = run.nodes / std::max(run.seconds, 1e-9);
+      if (run.threads == 1 && base_rate == 0) base_rate = rate;
+      std::cout << (first ? "\n" : ",\n") << "  {\"threads\": " << run.threads
+                << (options.mcts ? ", \"iterations\": " : ", \"beam_width\": ")
+                << size << ", \"moves\": " << run.moves
+                << ", \"nodes\": " << run.nodes << ", \"mean_depth\": "
+                << double(run.depth) / std::max(run.moves, 1)
+                << ", \"seconds\": " << run.seconds
+                << ", \"nodes_per_sec\": " << rate
+                << ", \"ms_per_move\": "
+                << 1e3 * run.seconds / std::max(run.moves, 1)
+                << ", \"p50_ms\": " << run.p50_ms
+                << ", \"p99_ms\": " << run.p99_ms
+                << ", \"attack\": " << run.attack << ", \"attack_per_move\": "
+                << double(run.attack) / std::max(run.moves, 1)
+                << ", \"peak_rss_kb\": " << run.peak_rss_kb
+                << ", \"parallel_efficiency\": ";
+      // speedup over one thread, divided by the threads used
+      if (base_rate > 0) {
+        std::cout << rate / (base_rate * run.threads);
+      } else {
+        std::cout << "null";
+      }
+      std::cout << "}";
+      first = false;
+    }
+  }
+  std::cout << "\n]}" << std::endl;
+  return 0;
+}
+
+// `options.budget_ms` (if positive) bounds the time per move; with
+// `-DINSTRUMENT` every move also prints its counters, and `trace` (if set)
+// gets a Chrome trace of the whole game
+void Play(const BenchOptions& options, const std::string& trace) {
+  instrument::SetTracing(!trace.empty());
   PlayerBoard pb;
   pb.LoadBoard(
       "#####...##\n"
@@ -20,108 +294,121 @@ int32_t main() {
   pb.set_current_piece(&pieces::T);
   std::cout << pb << "\n";
 
-  int total_nodes = 0;
-  for (int i = 0; i < 100; ++i) {
-    int best_placement_id = -1;
-    double best_eval = -1e9;
-    auto placements = pb.GeneratePlacements();
-    // <eval, id, pb_idx>
-    std::vector<std::tuple<double, int, int>> curr_id, next_id;
-    std::vector<PlayerBoard> curr_pb, next_pb;
-    for (int id = 0; id < (int)placements.size(); ++id) {
-      auto [x, y, d] = placements[id];
-      PlayerBoard pb_(pb);
-      pb_.SimulatePlacement(x, y, d);
-      double eval = pb_.Evaluate();
-      curr_id.push_back({eval, id, curr_id.size()});
-      curr_pb.push_back(std::move(pb_));
+  {
+    // the next move is searched while this one is applied and printed,
+    // unless the counters are collected per move: they must not be bumped
+    // while they are collected
+    Engine engine({.max_depth = 10,
+                   .beam_width = 1000,
+                   .branching_cap = 100,
+                   .time_budget_ms = options.budget_ms,
+                   .reuse = options.reuse,
+                   .hold = options.hold},
+                  /*ponder=*/!instrument::kEnabled);
+    int total_nodes = 0;
+    for (int i = 0; i < 100; ++i) {
+      auto result = engine.Think(pb);
+      auto [x, y, d] = result.placement;
+      pb.SimulatePlacement(x, y, d);
+      std::cout << std::string(10, '\n');
+      std::cout << pb;
+      std::cout << "eval=" << std::setw(6) << result.eval << "; ";
+      std::cout << "nodes explored=" << std::setw(7) << result.stats.nodes
+                << "; ";
+      std::cout << "depth=" << std::setw(2) << result.stats.depth << " ("
+                << result.stats.reused << " reused); ";
+      total_nodes += result.stats.nodes;
+      std::cout << "total explored=" << std::setw(7) << total_nodes << "; ";
+      if (instrument::kEnabled) {
+        std::cout << "\ninstrument=" << instrument::Collect().ToJson();
+      }
+      std::cout << std::endl;
     }
+    std::cout << "ponder hits=" << engine.stats().hits
+              << "; misses=" << engine.stats().misses << std::endl;
+  }  // the engine stops before the trace is written
+  if (!trace.empty()) {
+    std::ofstream out(trace);
+    instrument::WriteChromeTrace(out);
+  }
+}
 
-    int nodes_explored = 0;
-    const int max_depth = 10;
-    for (int curr_level = 2; curr_level <= max_depth; ++curr_level) {
-      std::sort(curr_id.rbegin(), curr_id.rend());
-
-      // sequential search
-      // for (size_t j = 0; j < std::min<size_t>(1000, curr_id.size()); ++j) {
-      //   ++nodes_explored;
-      //   auto [eval, id, pb_idx] = curr_id[j];
-      //   auto& pb = curr_pb[pb_idx];
-      //   if (curr_level == max_depth) {
-      //     if (eval > best_eval) {
-      //       best_eval = eval;
-      //       best_placement_id = id;
-      //     }
-      //   }
-      //   for (auto [x, y, d] : pb.GeneratePlacements()) {
-      //     PlayerBoard pb_(pb);
-      //     pb_.SimulatePlacement(x, y, d);
-      //     double eval = pb_.Evaluate();
-      //     next_id.push_back({eval, id, next_id.size()});
-      //     next_pb.push_back(pb_);
-      //   }
-      // };
-
-      // multithreaded search
-      std::vector<std::vector<std::tuple<double, int, int>>> next_ids(1000);
-      std::vector<std::vector<PlayerBoard>> next_pbs(1000);
-
-      auto ExploreNodeIndex = [&](size_t j) -> void {
-        auto [eval, id, pb_idx] = curr_id[j];
-        auto& pb = curr_pb[pb_idx];
-        auto placements = pb.GeneratePlacements();
-        for (size_t k = 0; k < std::min<size_t>(100, placements.size()); ++k) {
-          auto [x, y, d] = placements[k];
-          PlayerBoard pb_(pb);
-          pb_.SimulatePlacement(x, y, d);
-          double eval = pb_.Evaluate();
-          next_ids[j].push_back({eval, id, 0});
-          next_pbs[j].push_back(pb_);
-        }
-      };
-      const size_t max_j = std::min<size_t>(1000, curr_id.size());
-      // multithreaded mode (of parallel code)
-      parlay::parallel_for(0, std::min<size_t>(1000, curr_id.size()),
-                           ExploreNodeIndex);
-
-      // sequential mode (of parallel code)
-      // for (size_t j = 0; j < max_j; ++j) {
-      //   ExploreNodeIndex(j);
-      // }
-
-      // collecting results
-      for (size_t j = 0; j < max_j; ++j) {
-        for (size_t k = 0; k < next_ids[j].size(); ++k) {
-          auto [eval, id, pb_idx] = next_ids[j][k];
-          auto pb_ = next_pbs[j][k];
-          next_id.push_back({eval, id, next_id.size()});
-          next_pb.push_back(std::move(pb_));
-
-          if (curr_level == max_depth) {
-            if (eval > best_eval) {
-              best_eval = eval;
-              best_placement_id = id;
-            }
-          }
-          ++nodes_explored;
-        }
-      }
+}  // namespace
 
-      curr_pb.clear();
-      curr_id.clear();
-      std::swap(curr_pb, next_pb);
-      std::swap(curr_id, next_id);
+int32_t main(int argc, char** argv) {
+  BenchOptions options;
+  std::string trace;  // --trace=file.json
+  bool bench = false, bench_run = false;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = std::strchr(arg, '=');
+    value = value ? value + 1 : "";
+    bool ok = true;  // whether the value of a numeric flag parsed
+    if (!std::strcmp(arg, "--bench")) {
+      bench = true;
+    } else if (!std::strcmp(arg, "--bench-run")) {
+      bench_run = true;
+    } else if (!std::strncmp(arg, "--trace=", 8)) {
+      trace = value;
+    } else if (!std::strncmp(arg, "--moves=", 8)) {
+      ok = ParseInt(value, options.moves);
+    } else if (!std::strncmp(arg, "--positions=", 12)) {
+      ok = ParseInt(value, options.positions);
+    } else if (!std::strncmp(arg, "--threads=", 10)) {
+      ok = ParseList(value, options.threads);
+    } else if (!std::strncmp(arg, "--beams=", 8)) {
+      ok = ParseList(value, options.beams);
+    } else if (!std::strncmp(arg, "--depth=", 8)) {
+      ok = ParseInt(value, options.depth);
+    } else if (!std::strncmp(arg, "--cap=", 6)) {
+      ok = ParseInt(value, options.cap);
+    } else if (!std::strncmp(arg, "--engine=", 9)) {
+      if (std::strcmp(value, "beam") && std::strcmp(value, "mcts")) {
+        std::cerr << "unknown engine " << value << "\n";
+        return 1;
+      }
+      options.mcts = !std::strcmp(value, "mcts");
+    } else if (!std::strncmp(arg, "--iterations=", 13)) {
+      ok = ParseList(value, options.iterations);
+    } else if (!std::strcmp(arg, "--no-reuse")) {
+      options.reuse = false;
+    } else if (!std::strcmp(arg, "--hold")) {
+      options.hold = true;
+    } else if (!std::strncmp(arg, "--budget=", 9)) {
+      ok = ParseInt(value, options.budget_ms, /*min=*/0);
+    } else {
+      std::cerr << "unknown flag " << arg << "\n";
+      return 1;
+    }
+    if (!ok) {
+      std::cerr << "bad value " << arg << "\n";
+      return 1;
     }
+  }
 
-    assert(best_placement_id >= 0 && "should have at least ONE placement");
-    auto [x, y, d] = placements[best_placement_id];
-    pb.SimulatePlacement(x, y, d);
-    std::cout << std::string(10, '\n');
-    std::cout << pb;
-    std::cout << "eval=" << std::setw(6) << best_eval << "; ";
-    std::cout << "nodes explored=" << std::setw(7) << nodes_explored << "; ";
-    total_nodes += nodes_explored;
-    std::cout << "total explored=" << std::setw(7) << total_nodes << "; ";
-    std::cout << std::endl;
+  if (bench_run) {
+    const int size = options.sizes().front();
+    BenchRun run;
+    if (options.mcts) {
+      Mcts search({.iterations = size_t(size),
+                   .time_budget_ms = options.budget_ms,
+                   .hold = options.hold});
+      run = RunSetting(options, search, size);
+    } else {
+      BeamSearch search({.max_depth = options.depth,
+                         .beam_width = size_t(size),
+                         .branching_cap = size_t(options.cap),
+                         .time_budget_ms = options.budget_ms,
+                         .reuse = options.reuse,
+                         .hold = options.hold});
+      run = RunSetting(options, search, size);
+    }
+    std::cout << std::setprecision(9) << run.threads << " " << run.moves << " "
+              << run.nodes << " " << run.depth << " " << run.attack << " "
+              << run.seconds << " " << run.p50_ms << " " << run.p99_ms << " "
+              << run.peak_rss_kb << "\n";
+    return 0;
   }
-}
\ No newline at end of file
+  if (bench) return Bench(argv[0], options);
+  Play(options, trace);
+}
@@ -0,0 +1,100 @@
+/**
+ * self-play tournament between engine configurations
+ *
+ * Plays `--games` seeded 1P games with every configuration (`--a`, and
+ * `--b` if given, see `tournament::ParseConfig`) and prints attack per
+ * piece, survival and pieces per second as JSON, each with a 95% confidence
+ * interval. With `--b` it also prints `b - a` over the paired seeds, and
+ * with `--versus` the result of `b` against `a` in 2P matches.
+ */
+
+#include <parlay/parallel.h>
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "tournament.hh"
+
+namespace {
+
+void PrintEstimate(const char* name, const tournament::Estimate& estimate) {
+  std::cout << "\"" << name << "\": {\"mean\": " << estimate.mean
+            << ", \"ci\": " << estimate.ci << "}";
+}
+
+void PrintSummary(const tournament::Summary& summary) {
+  std::cout << "{";
+  PrintEstimate("attack_per_piece", summary.attack_per_piece);
+  std::cout << ", ";
+  PrintEstimate("survival", summary.survival);
+  std::cout << ", ";
+  PrintEstimate("pieces", summary.pieces);
+  std::cout << ", \"pieces_per_sec\": " << summary.pieces_per_sec << "}";
+}
+
+}  // namespace
+
+int32_t main(int argc, char** argv) {
+  tournament::Options options;
+  std::optional<tournament::Config> a = tournament::ParseConfig("greedy"), b;
+  bool versus = false;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = std::strchr(arg, '=');
+    value = value ? value + 1 : "";
+    if (!std::strncmp(arg, "--a=", 4) || !std::strncmp(arg, "--b=", 4)) {
+      auto config = tournament::ParseConfig(value);
+      if (!config) {
+        std::cerr << "bad config " << value << "\n";
+        return 1;
+      }
+      (arg[2] == 'a' ? a : b) = config;
+    } else if (!std::strcmp(arg, "--versus")) {
+      versus = true;
+    } else if (!std::strncmp(arg, "--games=", 8)) {
+      options.games = std::stoi(value);
+    } else if (!std::strncmp(arg, "--pieces=", 9)) {
+      options.max_pieces = std::stoi(value);
+    } else if (!std::strncmp(arg, "--seed=", 7)) {
+      options.first_seed = std::stoull(value);
+    } else {
+      std::cerr << "unknown flag " << arg << "\n";
+      return 1;
+    }
+  }
+  if (versus && !b) {
+    std::cerr << "--versus needs --b\n";
+    return 1;
+  }
+
+  std::cout << std::fixed << std::setprecision(4);
+  std::cout << "{\"threads\": " << parlay::num_workers()
+            << ", \"games\": " << options.games
+            << ", \"max_pieces\": " << options.max_pieces
+            << ", \"first_seed\": " << options.first_seed
+            << ",\n \"a\": {\"config\": \"" << a->name << "\", \"summary\": ";
+  auto run_a = tournament::Play(*a, options);
+  PrintSummary(tournament::Summarize(run_a));
+  std::cout << "}";
+  if (b) {
+    std::cout << ",\n \"b\": {\"config\": \"" << b->name
+              << "\", \"summary\": ";
+    auto run_b = tournament::Play(*b, options);
+    PrintSummary(tournament::Summarize(run_b));
+    std::cout << "},\n \"b_minus_a\": ";
+    PrintSummary(tournament::Difference(run_a, run_b));
+  }
+  if (versus) {
+    // scored for `b`, the challenger
+    auto h2h = tournament::PlayVersus(*b, *a, options);
+    std::cout << ",\n \"versus\": {\"b_wins\": " << h2h.a_wins
+              << ", \"a_wins\": " << h2h.b_wins << ", \"draws\": " << h2h.draws
+              << ", ";
+    PrintEstimate("b_score", h2h.score);
+    std::cout << "}";
+  }
+  std::cout << "}" << std::endl;
+}
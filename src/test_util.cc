@@ -0,0 +1,15 @@
+#include "test_util.hh"
+
+namespace test_util {
+
+PlayerBoard TestBoard() {
+  PlayerBoard pb;
+  pb.LoadBoard(
+      "#####...##\n"
+      "####...###\n"
+      "#####.####");
+  pb.set_current_piece(&pieces::T);
+  return pb;
+}
+
+}  // namespace test_util
@@ -0,0 +1,18 @@
+#ifndef SRC_TEST_UTIL_HH_
+#define SRC_TEST_UTIL_HH_
+
+#include "player_board.hh"
+
+/**
+ * Fixtures shared by the search tests.
+ */
+namespace test_util {
+
+/**
+ * @brief The start position of `search_1p`: a T with a T-spin slot.
+ */
+PlayerBoard TestBoard();
+
+}  // namespace test_util
+
+#endif  // SRC_TEST_UTIL_HH_
@@ -0,0 +1,220 @@
+#include "tournament.hh"
+
+#include <parlay/parallel.h>
+
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include "versus.hh"
+
+namespace tournament {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// the engine of one game
+class Player {
+ public:
+  explicit Player(const Config& config) {
+    if (config.mcts) {
+      Mcts::Options options = config.mcts_options;
+      options.workers = 1;  // the games are the parallelism
+      mcts_ = std::make_unique<Mcts>(options);
+    } else {
+      beam_ = std::make_unique<BeamSearch>(config.beam);
+    }
+  }
+
+  std::array<int, 3> Move(const PlayerBoard& pb) {
+    return mcts_ ? mcts_->Search(pb).placement : beam_->Search(pb).placement;
+  }
+
+ private:
+  std::unique_ptr<BeamSearch> beam_;
+  std::unique_ptr<Mcts> mcts_;
+};
+
+bool ToppedOut(const PlayerBoard& pb) {
+  return !pb.IsValidPosition(pb.px(), pb.py(), pb.pd());
+}
+
+Game PlayGame(const Config& config, uint64_t seed, int max_pieces) {
+  Player player(config);
+  PlayerBoard pb(seed);
+  Game game;
+  for (; game.pieces < max_pieces; ++game.pieces) {
+    if (ToppedOut(pb)) return game;
+    auto [x, y, d] = player.Move(pb);
+    pb.SimulatePlacement(x, y, d);
+    game.attack = pb.attack();
+  }
+  game.survived = true;
+  return game;
+}
+
+// `field` of every game of `run`, or of `b` minus `a` with `a` given
+template <typename Field>
+std::vector<double> Values(const Run& run, Field field,
+                           const Run* a = nullptr) {
+  std::vector<double> values(run.games.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = field(run.games[i]);
+    if (a) values[i] -= field(a->games[i]);
+  }
+  return values;
+}
+
+Summary SummarizeGames(const Run& run, const Run* a) {
+  Summary summary;
+  summary.attack_per_piece = Mean(Values(
+      run,
+      [](const Game& g) { return g.pieces ? double(g.attack) / g.pieces : 0; },
+      a));
+  summary.survival =
+      Mean(Values(run, [](const Game& g) { return double(g.survived); }, a));
+  summary.pieces =
+      Mean(Values(run, [](const Game& g) { return double(g.pieces); }, a));
+  return summary;
+}
+
+double PiecesPerSec(const Run& run) {
+  double pieces = 0;
+  for (const Game& game : run.games) pieces += game.pieces;
+  return run.seconds > 0 ? pieces / run.seconds : 0;
+}
+
+}  // namespace
+
+std::optional<Config> ParseConfig(const std::string& spec) {
+  Config config{.name = spec};
+  const size_t colon = spec.find(':');
+  const std::string engine = spec.substr(0, colon);
+  if (engine == "greedy") {
+    config.beam = {.max_depth = 1, .beam_width = 1};
+  } else if (engine == "mcts") {
+    config.mcts = true;
+  } else if (engine != "beam") {
+    return std::nullopt;
+  }
+  if (colon == spec.npos) return config;
+  std::istringstream in(spec.substr(colon + 1));
+  for (std::string item; std::getline(in, item, ',');) {
+    const size_t eq = item.find('=');
+    if (eq == item.npos) return std::nullopt;
+    const std::string key = item.substr(0, eq);
+    const std::string text = item.substr(eq + 1);
+    int value;
+    try {
+      size_t used;
+      value = std::stoi(text, &used);
+      if (used != text.size()) return std::nullopt;
+    } catch (const std::logic_error&) {  // not a number, or out of range
+      return std::nullopt;
+    }
+    // sizes and counts go into unsigned fields, `hold` is a flag
+    if (value < (key == "hold" ? 0 : 1)) return std::nullopt;
+    if (key == "hold" && value > 1) return std::nullopt;
+    if (!config.mcts && key == "width") {
+      config.beam.beam_width = value;
+    } else if (!config.mcts && key == "depth") {
+      config.beam.max_depth = value;
+    } else if (!config.mcts && key == "cap") {
+      config.beam.branching_cap = value;
+    } else if (key == "hold") {
+      config.beam.hold = config.mcts_options.hold = value;
+    } else if (config.mcts && key == "iterations") {
+      config.mcts_options.iterations = value;
+    } else if (config.mcts && key == "rollout") {
+      config.mcts_options.rollout_depth = value;
+    } else if (config.mcts && key == "samples") {
+      config.mcts_options.rollout_samples = value;
+    } else {
+      return std::nullopt;
+    }
+  }
+  return config;
+}
+
+Run Play(const Config& config, const Options& options) {
+  Run run;
+  run.games.resize(options.games);
+  auto start = Clock::now();
+  parlay::parallel_for(0, options.games, [&](size_t i) {
+    run.games[i] =
+        PlayGame(config, options.first_seed + i, options.max_pieces);
+  }, 1);
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  run.seconds = elapsed.count();
+  return run;
+}
+
+Estimate Mean(std::span<const double> values) {
+  Estimate estimate;
+  const size_t n = values.size();
+  if (n == 0) return estimate;
+  for (double v : values) estimate.mean += v;
+  estimate.mean /= n;
+  if (n < 2) return estimate;
+  double squares = 0;
+  for (double v : values) squares += (v - estimate.mean) * (v - estimate.mean);
+  // 1.96 standard errors, with the sample variance
+  estimate.ci = 1.96 * std::sqrt(squares / (n - 1) / n);
+  return estimate;
+}
+
+Summary Summarize(const Run& run) {
+  Summary summary = SummarizeGames(run, nullptr);
+  summary.pieces_per_sec = PiecesPerSec(run);
+  return summary;
+}
+
+Summary Difference(const Run& a, const Run& b) {
+  assert(a.games.size() == b.games.size() && "the same seeds");
+  Summary summary = SummarizeGames(b, &a);
+  summary.pieces_per_sec = PiecesPerSec(b) - PiecesPerSec(a);
+  return summary;
+}
+
+HeadToHead PlayVersus(const Config& a, const Config& b,
+                      const Options& options) {
+  // match 2 * i + 1 replays match 2 * i with the sides swapped
+  std::vector<Versus::Status> results(2 * options.games);
+  parlay::parallel_for(0, results.size(), [&](size_t k) {
+    Player first(k % 2 ? b : a), second(k % 2 ? a : b);
+    Versus game(options.first_seed + k / 2);
+    results[k] = game.Play(
+        [&](const Versus& match, int i) {
+          return first.Move(match.player(i));
+        },
+        [&](const Versus& match, int i) {
+          return second.Move(match.player(i));
+        },
+        options.max_pieces);
+  }, 1);
+
+  HeadToHead h2h;
+  std::vector<double> scores(options.games, 0);
+  for (size_t k = 0; k < results.size(); ++k) {
+    double points = 0.5;
+    if (results[k] == Versus::kDraw) {
+      ++h2h.draws;
+    } else if ((results[k] == Versus::kFirstWins) == (k % 2 == 0)) {
+      ++h2h.a_wins;
+      points = 1;
+    } else {
+      ++h2h.b_wins;
+      points = 0;
+    }
+    scores[k / 2] += points / 2;
+  }
+  h2h.score = Mean(scores);
+  return h2h;
+}
+
+}  // namespace tournament
@@ -0,0 +1,107 @@
+#ifndef SRC_TOURNAMENT_HH_
+#define SRC_TOURNAMENT_HH_
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "beam_search.hh"
+#include "mcts.hh"
+
+/**
+ * Seeded games for comparing engine configurations.
+ *
+ * Every configuration plays the same seeds (game `i` starts from
+ * `PlayerBoard(first_seed + i)`), so two configurations are compared seed by
+ * seed, which cancels out most of the luck of the pieces. Games run in
+ * parallel with parlay, one search per game: beam searches fork inside the
+ * same parlay scheduler, and MCTS runs with one worker since games are the
+ * parallelism. Results are stored per game and summed in order, so they are
+ * bit-for-bit the same for the same seeds, unless a time budget is set.
+ */
+namespace tournament {
+
+struct Config {
+  std::string name;
+  bool mcts = false;  // else a beam search
+  BeamSearch::Options beam;
+  Mcts::Options mcts_options;
+};
+
+/**
+ * @brief Parses `engine[:key=value,...]`, e.g. `beam:width=100,depth=4` or
+ * `mcts:iterations=2000`. Beam keys are width, depth and cap, MCTS keys are
+ * iterations, rollout and samples, and `hold=1` lets either hold. `greedy`
+ * is a beam of depth 1.
+ *
+ * @return `std::nullopt` for an unknown engine or key, or a value that is
+ * not a positive integer (`hold` takes 0 or 1)
+ */
+std::optional<Config> ParseConfig(const std::string& spec);
+
+struct Options {
+  int games = 100;       // seeds per configuration
+  int max_pieces = 100;  // a game that gets this far survived
+  uint64_t first_seed = 1;
+};
+
+struct Game {
+  int pieces = 0;
+  int attack = 0;
+  bool survived = false;  // did not top out before `max_pieces`
+};
+
+struct Run {
+  std::vector<Game> games;  // in seed order
+  double seconds = 0;       // wall time of all games
+};
+
+/**
+ * @brief Plays `options.games` 1P games of `config`.
+ */
+Run Play(const Config& config, const Options& options);
+
+// a mean with the half width of its 95% confidence interval
+struct Estimate {
+  double mean = 0, ci = 0;
+};
+
+/**
+ * @brief Mean of `values` with a normal approximation confidence interval.
+ */
+Estimate Mean(std::span<const double> values);
+
+struct Summary {
+  Estimate attack_per_piece;  // of a game, averaged over games
+  Estimate survival;          // fraction of games that survived
+  Estimate pieces;            // placed per game
+  double pieces_per_sec = 0;
+};
+
+Summary Summarize(const Run& run);
+
+/**
+ * @brief Every field of `b` minus the one of `a`, seed by seed, so both must
+ * have played the same seeds.
+ */
+Summary Difference(const Run& a, const Run& b);
+
+struct HeadToHead {
+  int a_wins = 0, b_wins = 0, draws = 0;
+  // per seed, the points of `a` over the two matches (a win is 1, a draw
+  // 1/2), divided by 2
+  Estimate score;
+};
+
+/**
+ * @brief Plays a `Versus` match for every seed twice, with `a` and `b`
+ * swapping sides, each capped at `max_pieces` pieces per player.
+ */
+HeadToHead PlayVersus(const Config& a, const Config& b,
+                      const Options& options);
+
+}  // namespace tournament
+
+#endif  // SRC_TOURNAMENT_HH_
@@ -0,0 +1,113 @@
+#include "tournament.hh"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+using tournament::Config;
+using tournament::ParseConfig;
+
+namespace {
+
+void ExpectSameGames(const tournament::Run& a, const tournament::Run& b) {
+  ASSERT_EQ(a.games.size(), b.games.size());
+  for (size_t i = 0; i < a.games.size(); ++i) {
+    EXPECT_EQ(a.games[i].pieces, b.games[i].pieces) << "game " << i;
+    EXPECT_EQ(a.games[i].attack, b.games[i].attack) << "game " << i;
+    EXPECT_EQ(a.games[i].survived, b.games[i].survived) << "game " << i;
+  }
+}
+
+}  // namespace
+
+TEST(Tournament, ParseConfig) {
+  auto beam = ParseConfig("beam:width=50,depth=3,cap=20");
+  ASSERT_TRUE(beam);
+  EXPECT_FALSE(beam->mcts);
+  EXPECT_EQ(beam->beam.beam_width, 50);
+  EXPECT_EQ(beam->beam.max_depth, 3);
+  EXPECT_EQ(beam->beam.branching_cap, 20);
+  EXPECT_EQ(beam->name, "beam:width=50,depth=3,cap=20");
+
+  auto greedy = ParseConfig("greedy");
+  ASSERT_TRUE(greedy);
+  EXPECT_EQ(greedy->beam.max_depth, 1);
+
+  auto mcts = ParseConfig("mcts:iterations=300,rollout=2");
+  ASSERT_TRUE(mcts);
+  EXPECT_TRUE(mcts->mcts);
+  EXPECT_EQ(mcts->mcts_options.iterations, 300);
+  EXPECT_EQ(mcts->mcts_options.rollout_depth, 2);
+  EXPECT_FALSE(mcts->mcts_options.hold);
+  EXPECT_TRUE(ParseConfig("mcts:hold=1")->mcts_options.hold);
+  EXPECT_TRUE(ParseConfig("greedy:hold=1")->beam.hold);
+
+  EXPECT_FALSE(ParseConfig("alphabeta"));
+  EXPECT_FALSE(ParseConfig("beam:iterations=3")) << "an MCTS key";
+  EXPECT_FALSE(ParseConfig("mcts:width")) << "no value";
+
+  EXPECT_FALSE(ParseConfig("beam:width=abc"));
+  EXPECT_FALSE(ParseConfig("beam:width=")) << "no value";
+  EXPECT_FALSE(ParseConfig("beam:width=10x"));
+  EXPECT_FALSE(ParseConfig("beam:width=99999999999")) << "out of range";
+  EXPECT_FALSE(ParseConfig("beam:width=-1")) << "would wrap around";
+  EXPECT_FALSE(ParseConfig("beam:depth=0"));
+  EXPECT_FALSE(ParseConfig("mcts:iterations=0"));
+  EXPECT_FALSE(ParseConfig("beam:hold=2"));
+  EXPECT_FALSE(ParseConfig("beam:hold=-1"));
+  ASSERT_TRUE(ParseConfig("beam:hold=0"));
+  EXPECT_FALSE(ParseConfig("beam:hold=0")->beam.hold);
+}
+
+TEST(Tournament, Mean) {
+  std::vector<double> values = {1, 2, 3, 4};
+  auto estimate = tournament::Mean(values);
+  EXPECT_DOUBLE_EQ(estimate.mean, 2.5);
+  // sample standard deviation sqrt(5/3), over sqrt(4)
+  EXPECT_DOUBLE_EQ(estimate.ci, 1.96 * std::sqrt(5.0 / 3) / 2);
+  EXPECT_EQ(tournament::Mean(std::vector<double>{7}).ci, 0);
+}
+
+TEST(Tournament, Reproducible) {
+  tournament::Options options{.games = 6, .max_pieces = 30, .first_seed = 5};
+  for (const char* spec : {"beam:width=20,depth=3", "mcts:iterations=100"}) {
+    auto config = ParseConfig(spec);
+    ASSERT_TRUE(config);
+    auto run = tournament::Play(*config, options);
+    ExpectSameGames(run, tournament::Play(*config, options));
+    for (const auto& game : run.games) {
+      EXPECT_EQ(game.survived, game.pieces == options.max_pieces) << spec;
+    }
+    auto summary = tournament::Summarize(run);
+    EXPECT_GE(summary.survival.mean, 0);
+    EXPECT_LE(summary.survival.mean, 1);
+    EXPECT_GT(summary.pieces_per_sec, 0);
+  }
+}
+
+TEST(Tournament, Difference) {
+  tournament::Options options{.games = 4, .max_pieces = 20};
+  auto a = tournament::Play(*ParseConfig("greedy"), options);
+  auto b = tournament::Play(*ParseConfig("beam:width=20,depth=3"), options);
+  auto diff = tournament::Difference(a, b);
+  auto sa = tournament::Summarize(a), sb = tournament::Summarize(b);
+  EXPECT_NEAR(diff.attack_per_piece.mean,
+              sb.attack_per_piece.mean - sa.attack_per_piece.mean, 1e-12);
+  // against itself every paired difference is zero
+  auto same = tournament::Difference(a, a);
+  EXPECT_EQ(same.attack_per_piece.mean, 0);
+  EXPECT_EQ(same.attack_per_piece.ci, 0);
+}
+
+TEST(Tournament, PlayVersus) {
+  tournament::Options options{.games = 3, .max_pieces = 40};
+  auto greedy = *ParseConfig("greedy");
+  auto h2h = tournament::PlayVersus(greedy, greedy, options);
+  EXPECT_EQ(h2h.a_wins + h2h.b_wins + h2h.draws, 2 * options.games);
+  // with sides swapped on every seed, a config scores exactly even against
+  // itself
+  EXPECT_EQ(h2h.a_wins, h2h.b_wins);
+  EXPECT_DOUBLE_EQ(h2h.score.mean, 0.5);
+  EXPECT_EQ(h2h.score.ci, 0);
+}
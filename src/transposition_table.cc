@@ -0,0 +1,38 @@
+#include "transposition_table.hh"
+
+TranspositionTable::TranspositionTable(int size_log2, Replace policy)
+    : slots_(new Slot[size_t(1) << size_log2]()),
+      mask_((size_t(1) << size_log2) - 1),
+      policy_(policy) {
+  Clear();
+}
+
+void TranspositionTable::Clear() {
+  for (size_t i = 0; i <= mask_; ++i) {
+    slots_[i].version.store(0, std::memory_order_relaxed);
+    slots_[i].key.store(0, std::memory_order_relaxed);
+    slots_[i].data.store(0, std::memory_order_relaxed);
+  }
+  for (auto& c : counters_) {
+    c.hits.store(0, std::memory_order_relaxed);
+    c.misses.store(0, std::memory_order_relaxed);
+    c.collisions.store(0, std::memory_order_relaxed);
+  }
+}
+
+TranspositionTable::Stats TranspositionTable::stats() const {
+  Stats stats;
+  for (const auto& c : counters_) {
+    stats.hits += c.hits.load(std::memory_order_relaxed);
+    stats.misses += c.misses.load(std::memory_order_relaxed);
+    stats.collisions += c.collisions.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+size_t TranspositionTable::Shard() {
+  static std::atomic<size_t> next_shard{0};
+  thread_local size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+  return shard;
+}
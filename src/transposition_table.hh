@@ -0,0 +1,185 @@
+#ifndef SRC_TRANSPOSITION_TABLE_HH_
+#define SRC_TRANSPOSITION_TABLE_HH_
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+
+/**
+ * Fixed-size, lock-free transposition table that can be shared by search
+ * threads (e.g. from inside `parlay::parallel_for`).
+ *
+ * Every slot holds the key and the packed entry behind a sequence counter
+ * (a seqlock): a store makes the counter odd while it checks the policy and
+ * writes both words, so the pair always changes as one unit. Probes never
+ * wait, a probe that overlaps a store shows up as a miss rather than as the
+ * wrong entry. Slots are direct mapped by the low bits of the key.
+ */
+class TranspositionTable {
+ public:
+  /**
+   * How `Entry::eval` relates to the true value of a position.
+   */
+  enum class Bound : uint8_t {
+    kExact,
+    kLower,  // the true value is at least `eval`
+    kUpper,  // the true value is at most `eval`
+  };
+
+  /**
+   * What a search remembers about one position.
+   */
+  struct Entry {
+    float eval = 0;
+    uint8_t depth = 0;           // depth the eval was computed with
+    int8_t x = 0, y = 0, d = 0;  // best placement found from the position
+    Bound bound = Bound::kExact;
+  };
+
+  /**
+   * Decides whether `Store` overwrites an occupied slot.
+   */
+  enum class Replace {
+    kAlways,      // the newest entry wins
+    kDeeper,      // keep whichever entry has the larger `depth`
+    kBetterEval,  // same key: keep the higher eval, ties go to the smaller
+                  // placement; other keys are always replaced
+  };
+
+  struct Stats {
+    uint64_t hits = 0;        // probes that found their key
+    uint64_t misses = 0;      // probes that found an empty slot
+    uint64_t collisions = 0;  // probes that found another key
+  };
+
+  /**
+   * @param size_log2 the table has `1 << size_log2` slots
+   * @param policy used by `Store`
+   */
+  explicit TranspositionTable(int size_log2, Replace policy = Replace::kDeeper);
+
+  /**
+   * @brief Looks up `key`, safe to call concurrently with `Store`.
+   *
+   * @return `true` and fills `entry` if `key` is present
+   */
+  bool Probe(uint64_t key, Entry& entry) const {
+    const Slot& slot = slots_[key & mask_];
+    // acquire loads keep the second version load after the pair, so a store
+    // that overlapped any of them changed the version
+    const uint64_t version = slot.version.load(std::memory_order_acquire);
+    const uint64_t stored = slot.key.load(std::memory_order_acquire);
+    const uint64_t data = slot.data.load(std::memory_order_acquire);
+    const bool torn =
+        version & 1 || slot.version.load(std::memory_order_relaxed) != version;
+    auto& counters = counters_[Shard()];
+    if (torn || !(data & kOccupied)) {
+      counters.misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    if (stored != key) {
+      counters.collisions.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    counters.hits.fetch_add(1, std::memory_order_relaxed);
+    entry = Unpack(data);
+    return true;
+  }
+
+  /**
+   * @brief Writes `entry` for `key` if the replacement policy allows it, safe
+   * to call concurrently with `Probe` and `Store`.
+   *
+   * @return `true` if the entry was written
+   */
+  bool Store(uint64_t key, const Entry& entry) {
+    Slot& slot = slots_[key & mask_];
+    // take the slot by making its version odd, other stores wait for it
+    uint64_t version = slot.version.load(std::memory_order_relaxed);
+    while (version & 1 || !slot.version.compare_exchange_weak(
+                              version, version + 1,
+                              std::memory_order_acquire,
+                              std::memory_order_relaxed)) {
+      version = slot.version.load(std::memory_order_relaxed);
+    }
+    const bool replaces = Replaces(key, entry,
+                                   slot.key.load(std::memory_order_relaxed),
+                                   slot.data.load(std::memory_order_relaxed));
+    if (replaces) {
+      // release: a probe that reads either word also sees the odd version
+      slot.key.store(key, std::memory_order_release);
+      slot.data.store(Pack(entry), std::memory_order_release);
+    }
+    // an unchanged slot gets its old version back, probes in between read
+    // the same pair anyway
+    slot.version.store(replaces ? version + 2 : version,
+                       std::memory_order_release);
+    return replaces;
+  }
+
+  /**
+   * @brief Empties the table and resets the counters, not thread safe.
+   */
+  void Clear();
+
+  Stats stats() const;
+  size_t size() const { return mask_ + 1; }
+  Replace policy() const { return policy_; }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> version;  // odd while a store holds the slot
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> data;     // packed `Entry`, 0 if empty
+  };
+  // counters are spread over cache lines to keep probes from contending
+  struct alignas(64) Counters {
+    std::atomic<uint64_t> hits, misses, collisions;
+  };
+  constexpr static size_t kShards = 64;
+  constexpr static uint64_t kOccupied = uint64_t(1) << 63;
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  Replace policy_;
+  mutable std::array<Counters, kShards> counters_;
+
+  // a small per-thread id used to pick a counter shard
+  static size_t Shard();
+
+  // whether `entry` for `key` replaces `old` for `old_key`, called with the
+  // slot held so both are consistent
+  bool Replaces(uint64_t key, const Entry& entry, uint64_t old_key,
+                uint64_t old) const {
+    if (!(old & kOccupied) || policy_ == Replace::kAlways) return true;
+    Entry prev = Unpack(old);
+    if (policy_ == Replace::kDeeper) return entry.depth >= prev.depth;
+    if (old_key != key) return true;
+    if (entry.eval != prev.eval) return entry.eval > prev.eval;
+    return std::array{entry.x, entry.y, entry.d} <
+           std::array{prev.x, prev.y, prev.d};
+  }
+
+  // layout: eval [0, 32), depth [32, 40), x [40, 48), y [48, 56),
+  // d [56, 59) (hold moves are 4 to 7), bound [59, 61), occupied bit 63
+  static uint64_t Pack(const Entry& e) {
+    return uint64_t(std::bit_cast<uint32_t>(e.eval)) |
+           uint64_t(e.depth) << 32 | uint64_t(uint8_t(e.x)) << 40 |
+           uint64_t(uint8_t(e.y)) << 48 | uint64_t(e.d & 7) << 56 |
+           uint64_t(e.bound) << 59 | kOccupied;
+  }
+  static Entry Unpack(uint64_t data) {
+    Entry e;
+    e.eval = std::bit_cast<float>(uint32_t(data));
+    e.depth = uint8_t(data >> 32);
+    e.x = int8_t(data >> 40);
+    e.y = int8_t(data >> 48);
+    e.d = int8_t((data >> 56) & 7);
+    e.bound = Bound((data >> 59) & 3);
+    return e;
+  }
+};
+
+#endif  // SRC_TRANSPOSITION_TABLE_HH_
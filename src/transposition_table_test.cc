@@ -0,0 +1,120 @@
+#include "transposition_table.hh"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(TranspositionTable, StoreProbe) {
+  TranspositionTable tt(4);
+  TranspositionTable::Entry e;
+  EXPECT_FALSE(tt.Probe(123, e)) << "empty table";
+  EXPECT_TRUE(tt.Store(123, {.eval = -1.5, .depth = 3, .x = -2, .y = 7, .d = 3}));
+  ASSERT_TRUE(tt.Probe(123, e));
+  EXPECT_EQ(e.eval, -1.5);
+  EXPECT_EQ(e.depth, 3);
+  EXPECT_EQ(e.x, -2);
+  EXPECT_EQ(e.y, 7);
+  EXPECT_EQ(e.d, 3);
+  EXPECT_EQ(e.bound, TranspositionTable::Bound::kExact);
+  EXPECT_FALSE(tt.Probe(123 + tt.size(), e)) << "same slot, other key";
+  auto stats = tt.stats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.collisions, 1);
+}
+
+TEST(TranspositionTable, Bound) {
+  TranspositionTable tt(4, TranspositionTable::Replace::kAlways);
+  TranspositionTable::Entry e;
+  for (auto bound : {TranspositionTable::Bound::kLower,
+                     TranspositionTable::Bound::kUpper,
+                     TranspositionTable::Bound::kExact}) {
+    tt.Store(5, {.eval = -7, .depth = 255, .d = 3, .bound = bound});
+    ASSERT_TRUE(tt.Probe(5, e));
+    EXPECT_EQ(e.bound, bound);
+    EXPECT_EQ(e.eval, -7);
+    EXPECT_EQ(e.depth, 255);
+    EXPECT_EQ(e.d, 3);
+  }
+}
+
+TEST(TranspositionTable, HoldPlacement) {
+  TranspositionTable tt(4);
+  TranspositionTable::Entry e;
+  for (int8_t d = 0; d < 8; ++d) {
+    tt.Clear();
+    tt.Store(9, {.x = -3, .y = 2, .d = d,
+                 .bound = TranspositionTable::Bound::kUpper});
+    ASSERT_TRUE(tt.Probe(9, e));
+    EXPECT_EQ(e.d, d) << "d >= 4 holds first";
+    EXPECT_EQ(e.x, -3);
+    EXPECT_EQ(e.y, 2);
+    EXPECT_EQ(e.bound, TranspositionTable::Bound::kUpper);
+  }
+}
+
+TEST(TranspositionTable, ReplaceDeeper) {
+  TranspositionTable tt(4, TranspositionTable::Replace::kDeeper);
+  TranspositionTable::Entry e;
+  tt.Store(1, {.eval = 1, .depth = 5});
+  EXPECT_FALSE(tt.Store(1, {.eval = 2, .depth = 4})) << "shallower";
+  EXPECT_FALSE(tt.Store(1 + tt.size(), {.eval = 2, .depth = 4}));
+  EXPECT_TRUE(tt.Store(1, {.eval = 3, .depth = 5}));
+  ASSERT_TRUE(tt.Probe(1, e));
+  EXPECT_EQ(e.eval, 3);
+}
+
+TEST(TranspositionTable, ReplaceBetterEval) {
+  TranspositionTable tt(4, TranspositionTable::Replace::kBetterEval);
+  TranspositionTable::Entry e;
+  tt.Store(1, {.eval = 1, .x = 5});
+  EXPECT_FALSE(tt.Store(1, {.eval = 0, .x = 0})) << "worse eval";
+  EXPECT_FALSE(tt.Store(1, {.eval = 1, .x = 6})) << "tie, larger placement";
+  EXPECT_TRUE(tt.Store(1, {.eval = 1, .x = 4})) << "tie, smaller placement";
+  ASSERT_TRUE(tt.Probe(1, e));
+  EXPECT_EQ(e.x, 4);
+  EXPECT_TRUE(tt.Store(1 + tt.size(), {.eval = -5})) << "other key";
+}
+
+TEST(TranspositionTable, Concurrent) {
+  TranspositionTable tt(10, TranspositionTable::Replace::kBetterEval);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&tt, t]() {
+      for (int i = 0; i < 20000; ++i) {
+        uint64_t key = 1 + i % 512;
+        tt.Store(key, {.eval = float(t), .depth = uint8_t(t)});
+        TranspositionTable::Entry e;
+        if (tt.Probe(key, e)) {
+          EXPECT_EQ(e.eval, e.depth) << "never torn";
+        }
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  for (uint64_t key = 1; key <= 512; ++key) {
+    TranspositionTable::Entry e;
+    ASSERT_TRUE(tt.Probe(key, e));
+    EXPECT_EQ(e.eval, 7) << "best eval survives";
+  }
+}
+
+TEST(TranspositionTable, ConcurrentSameSlot) {
+  TranspositionTable tt(4, TranspositionTable::Replace::kAlways);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&tt, t]() {
+      // keys of different threads share slots, every entry names its key
+      for (int i = 0; i < 20000; ++i) {
+        uint64_t key = 1 + (i % 4) + tt.size() * (t % 4);
+        tt.Store(key, {.eval = float(key), .depth = uint8_t(key)});
+        TranspositionTable::Entry e;
+        if (tt.Probe(key, e)) {
+          EXPECT_EQ(e.eval, key) << "the entry of another key";
+        }
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+}
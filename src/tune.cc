@@ -0,0 +1,173 @@
+/**
+ * tunes the weights of `PlayerBoard::Evaluate()` with SPSA
+ *
+ * Every iteration plays `--games` seeded 1P games of `--pieces` pieces with
+ * `--engine` (a `tournament::ParseConfig` spec) for each candidate weight
+ * vector, all candidates on the same seeds and all games in parallel. The
+ * objective is the attack sent per piece of `--pieces`, so topping out early
+ * costs the attack of the pieces not played. The state is checkpointed to
+ * `--checkpoint` after every iteration, and a run resumes from it until
+ * `--iterations` iterations are done. Prints one JSON line per iteration.
+ */
+
+#include <parlay/parallel.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "player_board.hh"
+#include "tournament.hh"
+#include "tuner.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const kWeightNames[EvalWeights::kSize] = {
+    "attack", "b2b", "lines", "combo", "bumpiness", "holes"};
+
+EvalWeights ToWeights(const std::vector<double>& theta) {
+  std::array<double, EvalWeights::kSize> a;
+  std::copy(theta.begin(), theta.end(), a.begin());
+  return EvalWeights::FromArray(a);
+}
+
+// mean attack per piece of `config` with `theta` over the seeds of `options`
+double Objective(tournament::Config config, const std::vector<double>& theta,
+                 const tournament::Options& options) {
+  config.beam.weights = config.mcts_options.weights = ToWeights(theta);
+  auto run = tournament::Play(config, options);
+  double attack = 0;
+  for (const auto& game : run.games) attack += game.attack;
+  return attack / (double(options.max_pieces) * run.games.size());
+}
+
+// parses `s` as a whole integer of at least `min` into `out`, false if it
+// is anything else
+bool ParseInt(const std::string& s, int& out, int min = 1) {
+  try {
+    size_t used;
+    const int value = std::stoi(s, &used);
+    if (used != s.size() || value < min) return false;
+    out = value;
+    return true;
+  } catch (const std::logic_error&) {  // not a number, or out of range
+    return false;
+  }
+}
+
+// parses `s` as a finite number above 0 into `out`, false otherwise
+bool ParsePositive(const std::string& s, double& out) {
+  try {
+    size_t used;
+    const double value = std::stod(s, &used);
+    if (used != s.size() || !std::isfinite(value) || value <= 0) return false;
+    out = value;
+    return true;
+  } catch (const std::logic_error&) {
+    return false;
+  }
+}
+
+// parses `s` as an unsigned 64-bit seed into `out`, false otherwise
+bool ParseSeed(const std::string& s, uint64_t& out) {
+  const char* end = s.data() + s.size();
+  auto [ptr, error] = std::from_chars(s.data(), end, out);
+  return error == std::errc() && ptr == end;
+}
+
+}  // namespace
+
+int32_t main(int argc, char** argv) {
+  std::string engine = "beam:width=20,depth=3";
+  std::string checkpoint = "tune_checkpoint.txt";
+  int iterations = 1000;
+  tournament::Options games{.games = 64, .max_pieces = 100};
+  // attack per piece moves by hundredths, so it takes a large gain for the
+  // first steps to move the weights by tens of percent
+  Spsa::Options options{.a = 5};
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = std::strchr(arg, '=');
+    value = value ? value + 1 : "";
+    bool ok = true;  // whether the value of a numeric flag parsed
+    if (!std::strncmp(arg, "--engine=", 9)) {
+      engine = value;
+    } else if (!std::strncmp(arg, "--checkpoint=", 13)) {
+      checkpoint = value;
+    } else if (!std::strncmp(arg, "--iterations=", 13)) {
+      ok = ParseInt(value, iterations);
+    } else if (!std::strncmp(arg, "--games=", 8)) {
+      ok = ParseInt(value, games.games);
+    } else if (!std::strncmp(arg, "--pieces=", 9)) {
+      ok = ParseInt(value, games.max_pieces);
+    } else if (!std::strncmp(arg, "--seed=", 7)) {
+      ok = ParseSeed(value, games.first_seed);
+    } else if (!std::strncmp(arg, "--pairs=", 8)) {
+      ok = ParseInt(value, options.pairs);
+    } else if (!std::strncmp(arg, "--a=", 4)) {
+      ok = ParsePositive(value, options.a);
+    } else if (!std::strncmp(arg, "--c=", 4)) {
+      ok = ParsePositive(value, options.c);
+    } else {
+      std::cerr << "unknown flag " << arg << "\n";
+      return 1;
+    }
+    if (!ok) {
+      std::cerr << "bad value " << arg << "\n";
+      return 1;
+    }
+  }
+  auto config = tournament::ParseConfig(engine);
+  if (!config) {
+    std::cerr << "bad engine " << engine << "\n";
+    return 1;
+  }
+
+  // start from the hand picked weights, and move each relative to its size
+  auto defaults = EvalWeights().ToArray();
+  std::vector<double> theta(defaults.begin(), defaults.end()), scale;
+  for (double w : theta) scale.push_back(std::abs(w));
+  Spsa spsa(options, theta, scale);
+  if (spsa.Load(checkpoint)) {
+    std::cerr << "resuming " << checkpoint << " at iteration "
+              << spsa.iteration() << "\n";
+  }
+
+  std::cout << std::fixed << std::setprecision(4);
+  while (spsa.iteration() < iterations) {
+    auto start = Clock::now();
+    spsa.Step([&](const std::vector<std::vector<double>>& candidates) {
+      std::vector<double> values(candidates.size());
+      parlay::parallel_for(0, candidates.size(), [&](size_t i) {
+        values[i] = Objective(*config, candidates[i], games);
+      }, 1);
+      return values;
+    });
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    if (!spsa.Save(checkpoint)) {
+      std::cerr << "could not write " << checkpoint << "\n";
+      return 1;
+    }
+    const size_t played = (2 * options.pairs + 1) * games.games;
+    std::cout << "{\"iteration\": " << spsa.iteration()
+              << ", \"value\": " << spsa.value() << ", \"weights\": {";
+    for (int i = 0; i < EvalWeights::kSize; ++i) {
+      std::cout << (i ? ", \"" : "\"") << kWeightNames[i]
+                << "\": " << spsa.theta()[i];
+    }
+    std::cout << "}, \"seconds\": " << elapsed.count()
+              << ", \"games_per_sec\": " << played / elapsed.count() << "}"
+              << std::endl;
+  }
+}
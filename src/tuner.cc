@@ -0,0 +1,88 @@
+#include "tuner.hh"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <utility>
+
+#include "hash.h"
+
+Spsa::Spsa(Options options, std::vector<double> theta,
+           std::vector<double> scale)
+    : options_(options), theta_(std::move(theta)), scale_(std::move(scale)) {
+  assert(theta_.size() == scale_.size() && options_.pairs >= 1);
+}
+
+double Spsa::Delta(int pair, size_t i) const {
+  uint64_t h = hash(options_.seed ^ hash(iteration_ ^ hash(pair ^ hash(i))));
+  return h & 1 ? 1 : -1;
+}
+
+void Spsa::Step(const Objective& objective) {
+  const double k = iteration_ + 1;
+  const double a_k = options_.a / std::pow(k + options_.big_a, options_.alpha);
+  const double c_k = options_.c / std::pow(k, options_.gamma);
+  const size_t n = theta_.size();
+
+  // theta + c_k delta and theta - c_k delta of every pair, then theta
+  std::vector<std::vector<double>> candidates;
+  for (int pair = 0; pair < options_.pairs; ++pair) {
+    for (double sign : {1.0, -1.0}) {
+      std::vector<double> candidate = theta_;
+      for (size_t i = 0; i < n; ++i) {
+        candidate[i] += sign * c_k * Delta(pair, i) * scale_[i];
+      }
+      candidates.push_back(std::move(candidate));
+    }
+  }
+  candidates.push_back(theta_);
+  const std::vector<double> values = objective(candidates);
+  assert(values.size() == candidates.size());
+
+  for (size_t i = 0; i < n; ++i) {
+    double gradient = 0;  // in units of `scale_[i]`
+    for (int pair = 0; pair < options_.pairs; ++pair) {
+      gradient += (values[2 * pair] - values[2 * pair + 1]) /
+                  (2 * c_k * Delta(pair, i));
+    }
+    theta_[i] += a_k * gradient / options_.pairs * scale_[i];
+  }
+  value_ = values.back();
+  ++iteration_;
+}
+
+bool Spsa::Save(const std::string& path) const {
+  const std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp);
+    // enough digits to read back the same doubles
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    out << "iteration " << iteration_ << "\nvalue " << value_ << "\ntheta";
+    for (double t : theta_) out << " " << t;
+    out << "\n";
+    if (!out.flush()) return false;
+  }
+  return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+bool Spsa::Load(const std::string& path) {
+  std::ifstream in(path);
+  std::string key;
+  int iteration;
+  double value;
+  std::vector<double> theta(theta_.size());
+  if (!(in >> key >> iteration) || key != "iteration") return false;
+  if (!(in >> key >> value) || key != "value") return false;
+  if (!(in >> key) || key != "theta") return false;
+  for (double& t : theta) {
+    if (!(in >> t)) return false;
+  }
+  if (double extra; in >> extra) return false;  // more parameters than ours
+  iteration_ = iteration;
+  value_ = value;
+  theta_ = std::move(theta);
+  return true;
+}
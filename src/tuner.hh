@@ -0,0 +1,77 @@
+#ifndef SRC_TUNER_HH_
+#define SRC_TUNER_HH_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * SPSA (simultaneous perturbation stochastic approximation) maximizer for
+ * noisy objectives such as the results of seeded games.
+ *
+ * Every iteration perturbs all parameters at once by a random +-1 vector
+ * times `c_k`, and estimates the gradient from the objective at the two
+ * sides. `pairs` perturbations are averaged per iteration, and all of their
+ * candidates go to the objective in one batch, so it can evaluate them in
+ * parallel on the same seeds (common random numbers). Parameters are tuned
+ * in units of their `scale`, so parameters of different magnitudes move
+ * alike.
+ *
+ * The perturbations are a hash of the seed and the iteration, so the state
+ * (iteration and parameters) is all a checkpoint needs to resume exactly.
+ */
+class Spsa {
+ public:
+  struct Options {
+    double a = 0.2;       // step size a_k = a / (k + 1 + big_a)^alpha
+    double big_a = 10;    // delays the decay of the first steps
+    double alpha = 0.602;
+    double c = 0.1;       // perturbation c_k = c / (k + 1)^gamma
+    double gamma = 0.101;
+    int pairs = 4;        // perturbations averaged per iteration
+    uint64_t seed = 1;
+  };
+
+  // the values of a batch of candidates, higher is better
+  using Objective = std::function<std::vector<double>(
+      const std::vector<std::vector<double>>& candidates)>;
+
+  Spsa(Options options, std::vector<double> theta, std::vector<double> scale);
+
+  /**
+   * @brief Runs one iteration, the batch also has the current parameters
+   * last, whose value becomes `value()`.
+   */
+  void Step(const Objective& objective);
+
+  int iteration() const { return iteration_; }
+  const std::vector<double>& theta() const { return theta_; }
+  // of `theta()` before the last step
+  double value() const { return value_; }
+
+  /**
+   * @brief Writes the state to `path`, through a temporary file so a crash
+   * never leaves a partial checkpoint.
+   */
+  bool Save(const std::string& path) const;
+
+  /**
+   * @brief Restores the state saved by `Save`.
+   *
+   * @return `false` if there is no readable checkpoint for as many
+   * parameters at `path`
+   */
+  bool Load(const std::string& path);
+
+ private:
+  Options options_;
+  std::vector<double> theta_, scale_;
+  int iteration_ = 0;
+  double value_ = 0;
+
+  // +1 or -1 for parameter `i` of perturbation `pair` of this iteration
+  double Delta(int pair, size_t i) const;
+};
+
+#endif  // SRC_TUNER_HH_
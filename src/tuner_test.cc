@@ -0,0 +1,75 @@
+#include "tuner.hh"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+// -|theta - target|^2, evaluated one candidate at a time
+std::vector<double> Quadratic(
+    const std::vector<std::vector<double>>& candidates) {
+  const std::vector<double> target = {3, -40, 0.5};
+  std::vector<double> values;
+  for (const auto& theta : candidates) {
+    double value = 0;
+    for (size_t i = 0; i < theta.size(); ++i) {
+      value -= (theta[i] - target[i]) * (theta[i] - target[i]) /
+               (i == 1 ? 100 : 1);  // parameter 1 moves at scale 10
+    }
+    values.push_back(value);
+  }
+  return values;
+}
+
+}  // namespace
+
+TEST(Spsa, Converges) {
+  Spsa spsa({.a = 1}, {0, 0, 0}, {1, 10, 1});
+  for (int i = 0; i < 300; ++i) spsa.Step(Quadratic);
+  EXPECT_EQ(spsa.iteration(), 300);
+  EXPECT_NEAR(spsa.theta()[0], 3, 0.01);
+  EXPECT_NEAR(spsa.theta()[1], -40, 0.1);
+  EXPECT_NEAR(spsa.theta()[2], 0.5, 0.01);
+  EXPECT_GT(spsa.value(), -1e-3) << "of the parameters before the last step";
+}
+
+TEST(Spsa, Batch) {
+  Spsa spsa({.pairs = 3}, {1, 2}, {1, 1});
+  size_t size = 0;
+  spsa.Step([&](const std::vector<std::vector<double>>& candidates) {
+    size = candidates.size();
+    EXPECT_EQ(candidates.back(), (std::vector<double>{1, 2}));
+    return std::vector<double>(candidates.size(), 0);
+  });
+  EXPECT_EQ(size, 2 * 3 + 1) << "two sides of every pair, then theta";
+  EXPECT_EQ(spsa.theta(), (std::vector<double>{1, 2})) << "flat objective";
+}
+
+TEST(Spsa, Checkpoint) {
+  const std::string path =
+      std::string(testing::TempDir()) + "/spsa_checkpoint.txt";
+  Spsa::Options options{.a = 1, .seed = 9};
+  Spsa spsa(options, {0, 0, 0}, {1, 10, 1});
+  for (int i = 0; i < 5; ++i) spsa.Step(Quadratic);
+  ASSERT_TRUE(spsa.Save(path));
+
+  Spsa resumed(options, {7, 7, 7}, {1, 10, 1});
+  ASSERT_TRUE(resumed.Load(path));
+  EXPECT_EQ(resumed.iteration(), 5);
+  EXPECT_EQ(resumed.theta(), spsa.theta()) << "bit for bit";
+  EXPECT_EQ(resumed.value(), spsa.value());
+  for (int i = 0; i < 5; ++i) {
+    spsa.Step(Quadratic);
+    resumed.Step(Quadratic);
+  }
+  EXPECT_EQ(resumed.theta(), spsa.theta()) << "resumes the same run";
+
+  Spsa other(options, {0, 0}, {1, 1});
+  EXPECT_FALSE(other.Load(path)) << "a different number of parameters";
+  EXPECT_FALSE(other.Load(path + ".missing"));
+  EXPECT_EQ(other.iteration(), 0);
+  std::remove(path.c_str());
+}
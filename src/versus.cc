@@ -0,0 +1,67 @@
+#include "versus.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "hash.h"
+
+Versus::Versus(uint64_t seed, Options options)
+    : options_(options),
+      players_{PlayerBoard(hash(2 * seed)),
+               PlayerBoard(hash(2 * seed + 1))} {}
+
+Versus::Status Versus::Step(const std::array<std::array<int, 3>, 2>& moves) {
+  assert(status_ == kPlaying && "the match is over");
+  std::array<int, 2> sent;
+  std::array<bool, 2> topped_out;
+  for (int i = 0; i < 2; ++i) {
+    PlayerBoard& pb = players_[i];
+    const int attack = pb.attack(), lines = pb.lines();
+    auto [x, y, d] = moves[i];
+    pb.SimulatePlacement(x, y, d);
+    sent[i] = pb.attack() - attack;
+    // what is sent cancels what is pending first
+    const int cancelled = std::min(sent[i], pending_[i]);
+    sent[i] -= cancelled;
+    pending_[i] -= cancelled;
+    topped_out[i] = false;
+    if (pb.lines() == lines && pending_[i] > 0) {
+      const int n = std::min(pending_[i], options_.garbage_cap);
+      pending_[i] -= n;
+      topped_out[i] = !pb.ReceiveGarbage(n);
+    }
+    topped_out[i] |= !pb.IsValidPosition(pb.px(), pb.py(), pb.pd());
+  }
+  // queued after receiving, so it enters no earlier than the next step
+  pending_[0] += sent[1];
+  pending_[1] += sent[0];
+  ++steps_;
+  if (topped_out[0] && topped_out[1]) {
+    status_ = kDraw;
+  } else if (topped_out[0]) {
+    status_ = kSecondWins;
+  } else if (topped_out[1]) {
+    status_ = kFirstWins;
+  }
+  return status_;
+}
+
+std::array<int, 3> GreedyMove(const Versus& game, int player) {
+  const PlayerBoard& pb = game.player(player);
+  std::array<std::array<int, 3>, PlayerBoard::kMaxPlacements> placements;
+  const int n = pb.GeneratePlacements(placements);
+  assert(n > 0 && "a piece that spawns has a placement");
+  int best = 0;
+  double best_eval = -std::numeric_limits<double>::infinity();
+  for (int i = 0; i < n; ++i) {
+    PlayerBoard next(pb);
+    auto [x, y, d] = placements[i];
+    next.SimulatePlacement(x, y, d);
+    if (double eval = next.Evaluate(); eval > best_eval) {
+      best_eval = eval;
+      best = i;
+    }
+  }
+  return placements[best];
+}
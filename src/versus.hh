@@ -0,0 +1,75 @@
+#ifndef SRC_VERSUS_HH_
+#define SRC_VERSUS_HH_
+
+#include <array>
+#include <cstdint>
+
+#include "player_board.hh"
+
+/**
+ * Two players stepped in lockstep, each placing one piece per step, with
+ * attack delivered to the opponent as garbage.
+ *
+ * Each player has their own pieces and garbage holes, both seeded from the
+ * match's seed, so equal policies still play different games. Lines a
+ * player sends first cancel garbage pending against them, the rest is
+ * queued against the opponent. Garbage enters after a piece that clears no
+ * lines, at most `garbage_cap` lines per piece, and never in the step it
+ * was sent, so the defender always has one piece to cancel it. A player
+ * tops out when garbage overflows their board or their next piece cannot
+ * spawn.
+ */
+class Versus {
+ public:
+  struct Options {
+    int garbage_cap = 8;  // most garbage lines entering per piece
+  };
+
+  enum Status : uint8_t { kPlaying, kFirstWins, kSecondWins, kDraw };
+
+  explicit Versus(uint64_t seed) : Versus(seed, Options{}) {}
+  Versus(uint64_t seed, Options options);
+
+  const PlayerBoard& player(int i) const { return players_[i]; }
+  // e.g. to load a board before the first step
+  PlayerBoard& player(int i) { return players_[i]; }
+  // garbage lines queued against player `i`
+  int pending(int i) const { return pending_[i]; }
+  int steps() const { return steps_; }
+  Status status() const { return status_; }
+
+  /**
+   * @brief Places `moves[i]` for player `i`, which must be one of their
+   * `GeneratePlacements()`, then exchanges garbage.
+   */
+  Status Step(const std::array<std::array<int, 3>, 2>& moves);
+
+  /**
+   * @brief Plays until someone tops out, or a draw after `max_steps`.
+   *
+   * @param first, second called as `policy(game, i)` for player `i`'s move
+   */
+  template <typename First, typename Second>
+  Status Play(First&& first, Second&& second, int max_steps) {
+    while (status_ == kPlaying) {
+      if (steps_ >= max_steps) return status_ = kDraw;
+      Step({first(*this, 0), second(*this, 1)});
+    }
+    return status_;
+  }
+
+ private:
+  Options options_;
+  std::array<PlayerBoard, 2> players_;
+  std::array<int, 2> pending_ = {0, 0};
+  int steps_ = 0;
+  Status status_ = kPlaying;
+};
+
+/**
+ * One-ply policy: the placement with the best `Evaluate()`, the first of
+ * them on ties. Cheap enough for thousands of matches per second.
+ */
+std::array<int, 3> GreedyMove(const Versus& game, int player);
+
+#endif  // SRC_VERSUS_HH_
@@ -0,0 +1,109 @@
+/**
+ * versus matches between two players
+ *
+ * Plays one match between two greedy players and prints both boards after
+ * every step. With `--headless` it instead plays `--matches` matches across
+ * all cores and prints the throughput and results as JSON.
+ */
+
+#include <parlay/parallel.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "versus.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  int matches = 10000;    // --matches: matches in headless mode
+  int max_steps = 500;    // --steps: a match is a draw after this many
+  uint64_t seed = 1;      // --seed: of the first match, the next get seed + i
+  int garbage_cap = 8;    // --cap: most garbage lines entering per piece
+};
+
+int Headless(const Options& options) {
+  std::vector<Versus::Status> results(options.matches);
+  std::vector<int> steps(options.matches);
+  auto start = Clock::now();
+  parlay::parallel_for(0, options.matches, [&](size_t i) {
+    Versus game(options.seed + i, {.garbage_cap = options.garbage_cap});
+    results[i] = game.Play(GreedyMove, GreedyMove, options.max_steps);
+    steps[i] = game.steps();
+  }, 1);
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+
+  std::array<int, 4> count{};
+  size_t total_steps = 0;
+  for (int i = 0; i < options.matches; ++i) {
+    ++count[results[i]];
+    total_steps += steps[i];
+  }
+  const double seconds = elapsed.count();
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "{\"threads\": " << parlay::num_workers()
+            << ", \"matches\": " << options.matches
+            << ", \"max_steps\": " << options.max_steps
+            << ", \"first_wins\": " << count[Versus::kFirstWins]
+            << ", \"second_wins\": " << count[Versus::kSecondWins]
+            << ", \"draws\": " << count[Versus::kDraw]
+            << ", \"mean_steps\": "
+            << double(total_steps) / std::max(options.matches, 1)
+            << ", \"seconds\": " << seconds
+            << ", \"matches_per_sec\": " << options.matches / seconds
+            << ", \"pieces_per_sec\": " << 2 * total_steps / seconds << "}"
+            << std::endl;
+  return 0;
+}
+
+void Watch(const Options& options) {
+  Versus game(options.seed, {.garbage_cap = options.garbage_cap});
+  while (game.status() == Versus::kPlaying) {
+    if (game.steps() >= options.max_steps) break;
+    game.Step({GreedyMove(game, 0), GreedyMove(game, 1)});
+    std::cout << std::string(10, '\n');
+    for (int i = 0; i < 2; ++i) {
+      std::cout << "player " << i << ": pending=" << game.pending(i) << "\n"
+                << game.player(i);
+    }
+    std::cout << "step=" << game.steps() << std::endl;
+  }
+  const char* names[] = {"draw", "player 0 wins", "player 1 wins", "draw"};
+  std::cout << names[game.status()] << std::endl;
+}
+
+}  // namespace
+
+int32_t main(int argc, char** argv) {
+  Options options;
+  bool headless = false;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = std::strchr(arg, '=');
+    value = value ? value + 1 : "";
+    if (!std::strcmp(arg, "--headless")) {
+      headless = true;
+    } else if (!std::strncmp(arg, "--matches=", 10)) {
+      options.matches = std::stoi(value);
+    } else if (!std::strncmp(arg, "--steps=", 8)) {
+      options.max_steps = std::stoi(value);
+    } else if (!std::strncmp(arg, "--seed=", 7)) {
+      options.seed = std::stoull(value);
+    } else if (!std::strncmp(arg, "--cap=", 6)) {
+      options.garbage_cap = std::stoi(value);
+    } else {
+      std::cerr << "unknown flag " << arg << "\n";
+      return 1;
+    }
+  }
+  if (headless) return Headless(options);
+  Watch(options);
+}
@@ -0,0 +1,98 @@
+#include "versus.hh"
+
+#include <gtest/gtest.h>
+
+#include <bit>
+#include <string>
+
+namespace {
+
+// the first placement of `pb` that does or does not clear lines
+std::array<int, 3> FindMove(const PlayerBoard& pb, bool clears) {
+  for (auto [x, y, d] : pb.GeneratePlacements()) {
+    PlayerBoard next(pb);
+    next.SimulatePlacement(x, y, d);
+    if ((next.lines() > pb.lines()) == clears) return {x, y, d};
+  }
+  ADD_FAILURE() << "no such placement";
+  return {};
+}
+
+// four rows open in the last column, and the I pieces to clear them
+void SetUpQuad(PlayerBoard& pb) {
+  pb.LoadBoard(
+      "#########.\n"
+      "#########.\n"
+      "#########.\n"
+      "#########.");
+  pb.SetQueue({&pieces::I, &pieces::I, &pieces::O});
+}
+
+}  // namespace
+
+TEST(Versus, SendsGarbage) {
+  Versus game(1);
+  SetUpQuad(game.player(0));
+  SetUpQuad(game.player(1));
+  game.Step({FindMove(game.player(0), true), FindMove(game.player(1), false)});
+  EXPECT_EQ(game.pending(1), 4) << "a quad sends 4";
+  EXPECT_EQ(game.pending(0), 0);
+  EXPECT_EQ(game.player(1).board().grid.row(0), 0b0111111111)
+      << "nothing enters in the step it was sent";
+
+  game.Step({FindMove(game.player(0), false), FindMove(game.player(1), false)});
+  EXPECT_EQ(game.pending(1), 0);
+  const Board::Row garbage = game.player(1).board().grid.row(0);
+  EXPECT_EQ(std::popcount(garbage), Board::width - 1);
+  for (int i = 1; i < 4; ++i) {
+    EXPECT_EQ(game.player(1).board().grid.row(i), garbage) << "row " << i;
+  }
+  EXPECT_EQ(game.player(1).board().grid.row(4), 0b0111111111);
+  EXPECT_EQ(game.status(), Versus::kPlaying);
+  EXPECT_EQ(game.steps(), 2);
+}
+
+TEST(Versus, Cancels) {
+  Versus game(1);
+  SetUpQuad(game.player(0));
+  SetUpQuad(game.player(1));
+  game.Step({FindMove(game.player(0), true), FindMove(game.player(1), false)});
+  ASSERT_EQ(game.pending(1), 4);
+  game.Step({FindMove(game.player(0), false), FindMove(game.player(1), true)});
+  EXPECT_EQ(game.pending(1), 0) << "the quad back cancels it";
+  EXPECT_EQ(game.pending(0), 0) << "and nothing is left to send";
+  for (int i = 0; i < Board::height; ++i) {
+    EXPECT_NE(std::popcount(game.player(1).board().grid.row(i)),
+              Board::width - 1)
+        << "no garbage entered, row " << i;
+  }
+}
+
+TEST(Versus, TopsOut) {
+  Versus game(1, {.garbage_cap = 4});
+  SetUpQuad(game.player(0));
+  PlayerBoard& pb = game.player(1);
+  std::string stack;
+  for (int i = 0; i < 18; ++i) stack += "#.#.#.#.#.\n";
+  pb.LoadBoard(stack);
+  pb.SetQueue({&pieces::I, &pieces::I, &pieces::O});
+  game.Step({FindMove(game.player(0), true), FindMove(game.player(1), false)});
+  ASSERT_EQ(game.status(), Versus::kPlaying);
+  game.Step({FindMove(game.player(0), false), FindMove(game.player(1), false)});
+  EXPECT_EQ(game.status(), Versus::kFirstWins);
+}
+
+TEST(Versus, Play) {
+  for (uint64_t seed = 1; seed <= 4; ++seed) {
+    Versus game(seed);
+    auto status = game.Play(GreedyMove, GreedyMove, 200);
+    EXPECT_NE(status, Versus::kPlaying);
+    EXPECT_LE(game.steps(), 200);
+    EXPECT_EQ(status == Versus::kDraw, game.steps() == 200) << "seed " << seed;
+    // the same seed plays the same match
+    Versus replay(seed);
+    EXPECT_EQ(replay.Play(GreedyMove, GreedyMove, 200), status);
+    EXPECT_EQ(replay.player(0), game.player(0));
+    EXPECT_EQ(replay.player(1), game.player(1));
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef SRC_ZOBRIST_HH_
+#define SRC_ZOBRIST_HH_
+
+#include <array>
+#include <cstdint>
+
+#include "board.hh"
+#include "hash.h"
+
+/**
+ * Zobrist keys for incrementally hashing game states, generated at compile
+ * time from the splitmix `hash()`. A state's key is the XOR of the keys of
+ * its filled cells, its queue position, hold piece, b2b and combo.
+ */
+namespace zobrist {
+
+// rows are split into two halves so a whole row is keyed with two lookups
+constexpr int kHalf = (Board::width + 1) / 2;
+
+constexpr uint64_t Cell(int i, int j) {
+  return hash(uint64_t(i) * Board::width + j);
+}
+
+// kRowKeys[i][h][bits] is the key of `bits` in half `h` of row `i`
+inline constexpr auto kRowKeys = [] {
+  std::array<std::array<std::array<uint64_t, 1 << kHalf>, 2>, Board::height>
+      keys{};
+  for (int i = 0; i < Board::height; ++i) {
+    for (int h = 0; h < 2; ++h) {
+      for (int bits = 0; bits < (1 << kHalf); ++bits) {
+        for (int j = 0; j < kHalf && h * kHalf + j < Board::width; ++j) {
+          if (bits >> j & 1) keys[i][h][bits] ^= Cell(i, h * kHalf + j);
+        }
+      }
+    }
+  }
+  return keys;
+}();
+
+/**
+ * @return the XOR of the keys of the cells set in `row` on row `i`
+ */
+constexpr uint64_t Row(int i, Board::Row row) {
+  return kRowKeys[i][0][row & ((1 << kHalf) - 1)] ^ kRowKeys[i][1][row >> kHalf];
+}
+
+constexpr uint64_t Grid(const Board::Grid& grid) {
+  uint64_t key = 0;
+  for (int i = 0; i < Board::height; ++i) key ^= Row(i, grid.row(i));
+  return key;
+}
+
+// scalar features are keyed on the fly, each with its own stream
+constexpr uint64_t QueueIndex(int index) {
+  return hash(uint64_t(1) << 40 | index);
+}
+constexpr uint64_t B2b(int b2b) { return hash(uint64_t(2) << 40 | b2b); }
+constexpr uint64_t Combo(int combo) { return hash(uint64_t(3) << 40 | combo); }
+// the empty hold (id 7) has no key, so states that never held keep theirs
+constexpr uint64_t Hold(int id) {
+  return id < 7 ? hash(uint64_t(4) << 40 | id) : 0;
+}
+
+}  // namespace zobrist
+
+#endif  // SRC_ZOBRIST_HH_